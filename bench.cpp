@@ -0,0 +1,1215 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <algorithm>
+#include <map>
+#include <memory_resource>
+#if defined(__unix__)
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <fcntl.h>
+#endif
+#include "ghjson.hpp"
+
+using namespace std;
+
+//统计堆分配次数: 替换全部的全局operator new/delete，普通、数组、nothrow和对齐的版本都走这里
+atomic<size_t> allocations(0);  // ndjson会在多个线程里分配
+
+void * countedAlloc(size_t size, size_t align) noexcept
+{
+    allocations.fetch_add(1, memory_order_relaxed);
+    size = size ? size : 1;
+    if(align <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+        return malloc(size);
+    return aligned_alloc(align, (size + align - 1) / align * align);
+}
+void * countedNew(size_t size, size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+{
+    if(void * p = countedAlloc(size, align))
+        return p;
+    throw bad_alloc();
+}
+void countedFree(void * p) noexcept { free(p); }
+
+void * operator new(size_t size) { return countedNew(size); }
+void * operator new[](size_t size) { return countedNew(size); }
+void * operator new(size_t size, align_val_t align) { return countedNew(size, size_t(align)); }
+void * operator new[](size_t size, align_val_t align) { return countedNew(size, size_t(align)); }
+void * operator new(size_t size, const nothrow_t &) noexcept { return countedAlloc(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void * operator new[](size_t size, const nothrow_t &) noexcept { return countedAlloc(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void * operator new(size_t size, align_val_t align, const nothrow_t &) noexcept { return countedAlloc(size, size_t(align)); }
+void * operator new[](size_t size, align_val_t align, const nothrow_t &) noexcept { return countedAlloc(size, size_t(align)); }
+void operator delete(void * p) noexcept { countedFree(p); }
+void operator delete[](void * p) noexcept { countedFree(p); }
+void operator delete(void * p, size_t) noexcept { countedFree(p); }
+void operator delete[](void * p, size_t) noexcept { countedFree(p); }
+void operator delete(void * p, align_val_t) noexcept { countedFree(p); }
+void operator delete[](void * p, align_val_t) noexcept { countedFree(p); }
+void operator delete(void * p, size_t, align_val_t) noexcept { countedFree(p); }
+void operator delete[](void * p, size_t, align_val_t) noexcept { countedFree(p); }
+void operator delete(void * p, const nothrow_t &) noexcept { countedFree(p); }
+void operator delete[](void * p, const nothrow_t &) noexcept { countedFree(p); }
+void operator delete(void * p, align_val_t, const nothrow_t &) noexcept { countedFree(p); }
+void operator delete[](void * p, align_val_t, const nothrow_t &) noexcept { countedFree(p); }
+
+template<typename F>
+double TimeMs(F && f, int repeat = 1)
+{
+    auto start = chrono::steady_clock::now();
+    for(int i = 0; i < repeat; i++)
+        f();
+    auto end = chrono::steady_clock::now();
+    return chrono::duration<double, milli>(end - start).count() / repeat;
+}
+
+string MakeNumberArray(size_t n)
+{
+    string out = "[";
+    for(size_t i = 0; i < n; i++)
+    {
+        if(i)
+            out += ',';
+        switch(i % 4)
+        {
+            case 0: out += to_string(i); break;
+            case 1: out += "-" + to_string(i) + ".25"; break;
+            case 2: out += "3.14159265358979e-" + to_string(i % 300); break;
+            case 3: out += "0.1"; break;
+        }
+    }
+    out += ']';
+    return out;
+}
+
+//旧实现: 每个数字都 stod(str.substr(idx))
+double LegacyParseNumbers(const string & str)
+{
+    double sum = 0;
+    size_t idx = 1;
+    while(idx < str.size() && str[idx] != ']')
+    {
+        size_t processed = 0;
+        sum += stod(str.substr(idx), &processed);
+        idx += processed;
+        if(str[idx] == ',')
+            idx++;
+    }
+    return sum;
+}
+
+void BenchNumber()
+{
+    cout << "== parse number array ==" << endl;
+    for(size_t n : {10000, 100000, 1000000})
+    {
+        string in = MakeNumberArray(n);
+        size_t size = 0;
+        double ms = TimeMs([&]{ size = ghjson::parse(in).getArray().size(); }, 3);
+        cout << setw(8) << n << " numbers: " << setw(10) << ms << " ms, "
+             << setw(8) << ms * 1e6 / n << " ns/number" << endl;
+    }
+    cout << "-- legacy stod(substr) --" << endl;
+    for(size_t n : {5000, 10000, 20000})
+    {
+        string in = MakeNumberArray(n);
+        double ms = TimeMs([&]{ LegacyParseNumbers(in); });
+        cout << setw(8) << n << " numbers: " << setw(10) << ms << " ms, "
+             << setw(8) << ms * 1e6 / n << " ns/number" << endl;
+    }
+}
+
+//大量小对象的请求体
+string MakePayload(size_t n)
+{
+    string out = "[";
+    for(size_t i = 0; i < n; i++)
+    {
+        if(i)
+            out += ',';
+        out += "{\"id\":" + to_string(i) + ",\"name\":\"user" + to_string(i % 100)
+            + "\",\"active\":" + (i % 2 ? "true" : "false") + ",\"score\":" + to_string(i % 97) + ".5"
+            + ",\"tags\":[\"a\",\"b\",null]}";
+    }
+    out += ']';
+    return out;
+}
+
+void BenchDocument()
+{
+    cout << "== Json tree vs arena Document vs view ==" << endl;
+    for(size_t n : {1000, 10000, 100000})
+    {
+        string in = MakePayload(n);
+        size_t before = allocations;
+        double treeMs = TimeMs([&]{ ghjson::parse(in); }, 3);
+        size_t treeAllocs = (allocations - before) / 3;
+
+        size_t docBytes = 0;
+        before = allocations;
+        double docMs = TimeMs([&]{ docBytes = ghjson::parseDocument(in).memoryUsage(); }, 3);
+        size_t docAllocs = (allocations - before) / 3;
+
+        size_t viewBytes = 0;
+        double viewMs = TimeMs([&]{ viewBytes = ghjson::parseView(in).memoryUsage(); }, 3);
+
+        cout << setw(7) << n << " records: Json " << setw(9) << treeMs << " ms, " << setw(8) << treeAllocs << " allocs | "
+             << "Document " << setw(9) << docMs << " ms, " << setw(5) << docAllocs << " allocs, " << setw(9) << docBytes << " bytes | "
+             << "view " << setw(9) << viewMs << " ms, " << setw(9) << viewBytes << " bytes" << endl;
+    }
+}
+
+//旧的布局: 每个值都是堆上的虚类对象
+namespace legacy
+{
+    struct Value
+    {
+        virtual ghjson::JsonType type() const = 0;
+        virtual double getNumber() const { throw runtime_error("type"); }
+        virtual bool getBool() const { throw runtime_error("type"); }
+        virtual unique_ptr<Value> clone() const = 0;
+        virtual ~Value() {}
+    };
+    struct Null : Value
+    {
+        ghjson::JsonType type() const override { return ghjson::JsonType::NUL; }
+        unique_ptr<Value> clone() const override { return make_unique<Null>(); }
+    };
+    struct Bool : Value
+    {
+        bool v;
+        explicit Bool(bool value) : v(value) {}
+        ghjson::JsonType type() const override { return ghjson::JsonType::BOOL; }
+        bool getBool() const override { return v; }
+        unique_ptr<Value> clone() const override { return make_unique<Bool>(v); }
+    };
+    struct Number : Value
+    {
+        double v;
+        explicit Number(double value) : v(value) {}
+        ghjson::JsonType type() const override { return ghjson::JsonType::NUMBER; }
+        double getNumber() const override { return v; }
+        unique_ptr<Value> clone() const override { return make_unique<Number>(v); }
+    };
+    struct Json
+    {
+        unique_ptr<Value> p;
+        Json() : p(make_unique<Null>()) {}
+        Json(bool value) : p(make_unique<Bool>(value)) {}
+        Json(double value) : p(make_unique<Number>(value)) {}
+        Json(const Json & other) : p(other.p->clone()) {}
+        Json(Json &&) = default;
+        bool is_number() const { return p->type() == ghjson::JsonType::NUMBER; }
+        double getNumber() const { return p->getNumber(); }
+    };
+}
+
+template<typename J>
+void RunLayout(const char * name, size_t n)
+{
+    vector<J> values;
+    values.reserve(n);
+    size_t before = allocations;
+    double buildMs = TimeMs([&]
+    {
+        for(size_t i = 0; i < n; i++)
+        {
+            switch(i % 3)
+            {
+                case 0: values.emplace_back(); break;
+                case 1: values.emplace_back(i % 2 == 0); break;
+                case 2: values.emplace_back(double(i)); break;
+            }
+        }
+    });
+    size_t buildAllocs = allocations - before;
+
+    double sum = 0;
+    double scanMs = TimeMs([&]
+    {
+        for(const auto & value : values)
+            if(value.is_number())
+                sum += value.getNumber();
+    });
+    double copyMs = TimeMs([&]{ vector<J> copy(values); });
+
+    cout << setw(8) << name << ": sizeof " << setw(2) << sizeof(J) << ", build " << setw(8) << buildMs << " ms ("
+         << buildAllocs << " allocs), scan " << setw(8) << scanMs << " ms, copy " << setw(8) << copyMs << " ms"
+         << (sum < 0 ? "!" : "") << endl;
+}
+
+void BenchLayout()
+{
+    cout << "== value layout, 1M scalars ==" << endl;
+    RunLayout<legacy::Json>("boxed", 1000000);
+    RunLayout<ghjson::Json>("tagged", 1000000);
+}
+
+//每层交替使用数组和对象，并带几个标量兄弟节点
+string MakeNested(size_t depth)
+{
+    if(depth == 0)
+        return "\"leaf\"";
+    string inner = MakeNested(depth - 1);
+    if(depth % 2)
+        return "[\"some text here\", 1.5, true, " + inner + "]";
+    return "{\"name\": \"some text here\", \"n\": 1.5, \"child\": " + inner + "}";
+}
+
+size_t CountNodes(const ghjson::Json & json)
+{
+    size_t nodes = 1;
+    if(json.is_array())
+        for(auto iter = json.arrayBegin_const(); iter != json.arrayEnd_const(); ++iter)
+            nodes += CountNodes(*iter);
+    else if(json.is_object())
+        for(auto iter = json.objectBegin_const(); iter != json.objectEnd_const(); ++iter)
+            nodes += CountNodes(iter->second);
+    return nodes;
+}
+
+void BenchNested()
+{
+    cout << "== nested parse, allocations per node ==" << endl;
+    for(size_t depth : {1, 2, 5, 10, 20, 40})
+    {
+        string in = MakeNested(depth);
+        size_t before = allocations;
+        ghjson::Json json = ghjson::parse(in);
+        size_t allocs = allocations - before;
+        size_t nodes = CountNodes(json);
+        cout << "depth " << setw(4) << depth << ": " << setw(6) << nodes << " nodes, " << setw(7) << allocs << " allocs, "
+             << setw(6) << double(allocs) / nodes << " allocs/node" << endl;
+    }
+}
+
+//旧的拷贝语义: 递归复制整棵树
+ghjson::Json DeepCopy(const ghjson::Json & json)
+{
+    if(json.is_array())
+    {
+        ghjson::array out;
+        for(auto iter = json.arrayBegin_const(); iter != json.arrayEnd_const(); ++iter)
+            out.push_back(DeepCopy(*iter));
+        return ghjson::Json(std::move(out));
+    }
+    if(json.is_object())
+    {
+        ghjson::object out;
+        for(auto iter = json.objectBegin_const(); iter != json.objectEnd_const(); ++iter)
+            out.emplace(iter->first, DeepCopy(iter->second));
+        return ghjson::Json(std::move(out));
+    }
+    if(json.is_string())
+        return ghjson::Json(json.getString());
+    return json;
+}
+
+void BenchCopy()
+{
+    cout << "== hand one config to 32 workers ==" << endl;
+    ghjson::Json config = ghjson::parse("{\"users\": " + MakePayload(10000) + ", \"limits\": {\"rps\": 100}}");
+    vector<ghjson::Json> workers;
+
+    size_t before = allocations;
+    double deepMs = TimeMs([&]{ for(int i = 0; i < 32; i++) workers.push_back(DeepCopy(config)); });
+    cout << "deep copy : " << setw(9) << deepMs << " ms, " << setw(8) << allocations - before << " allocs" << endl;
+    workers.clear();
+    workers.reserve(32);
+
+    before = allocations;
+    double cowMs = TimeMs([&]{ for(int i = 0; i < 32; i++) workers.push_back(config); });
+    cout << "shared    : " << setw(9) << cowMs << " ms, " << setw(8) << allocations - before << " allocs" << endl;
+
+    before = allocations;
+    double writeMs = TimeMs([&]{ workers[0]["limits"]["rps"].setNumber(200); });
+    cout << "first write to one path: " << writeMs << " ms, " << allocations - before << " allocs" << endl;
+}
+
+//缩进排版、带较长文本的API响应
+string MakeApiResponse(size_t n)
+{
+    string out = "{\n  \"data\": [\n";
+    for(size_t i = 0; i < n; i++)
+    {
+        if(i)
+            out += ",\n";
+        out += "    {\n      \"id\": " + to_string(i) + ",\n      \"title\": \"Lorem ipsum dolor sit amet, consectetur adipiscing elit " + to_string(i)
+            + "\",\n      \"body\": \"Sed ut perspiciatis unde omnis iste natus error sit voluptatem accusantium doloremque laudantium, totam rem aperiam\",\n"
+            + "      \"score\": " + to_string(i % 1000) + ".25,\n      \"public\": true\n    }";
+    }
+    out += "\n  ]\n}\n";
+    return out;
+}
+
+void RunStructural(const char * name, const string & in)
+{
+    ghjson::ParseOptions options;
+    options.structural_index = true;
+    vector<uint32_t> index;
+    double gb = in.size() / 1e9;
+    double stage1Ms = TimeMs([&]{ ghjson::scanStructurals(in, index); }, 10);
+    double parseMs = TimeMs([&]{ ghjson::parse(in); }, 3);
+    double twoStageMs = TimeMs([&]{ ghjson::parse(in, options); }, 3);
+    cout << setw(10) << name << " " << setw(6) << in.size() / 1000000.0 << " MB: stage1 " << setw(6) << gb / (stage1Ms / 1e3) << " GB/s, "
+         << "parse " << setw(6) << gb / (parseMs / 1e3) << " GB/s, two-stage parse " << setw(6) << gb / (twoStageMs / 1e3) << " GB/s" << endl;
+}
+
+void BenchStructural()
+{
+    cout << "== structural index ==" << endl;
+    RunStructural("records", MakePayload(100000));
+    RunStructural("api", MakeApiResponse(50000));
+}
+
+//旧实现: 逐字符判断并 += 到结果
+size_t LegacyParseString(const string & str, size_t idx, string & out)
+{
+    idx++;
+    while(str[idx] != '"')
+    {
+        if(str[idx] == '\\')
+        {
+            idx++;
+            switch(str[idx])
+            {
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                default : out += str[idx]; break;
+            }
+        }
+        else
+            out += str[idx];
+        idx++;
+    }
+    return idx + 1;
+}
+
+//escapeEvery为0时不带转义
+string MakeStringArray(size_t n, size_t length, size_t escapeEvery)
+{
+    string out = "[";
+    for(size_t i = 0; i < n; i++)
+    {
+        if(i)
+            out += ',';
+        out += '"';
+        for(size_t j = 0; j < length; j++)
+        {
+            if(escapeEvery && j % escapeEvery == 0)
+                out += "\\n";
+            else
+                out += char('a' + (i + j) % 26);
+        }
+        out += '"';
+    }
+    out += ']';
+    return out;
+}
+
+//每个字符串解码后拷进同一个缓冲，和旧的逐字符循环做同样的事，不建树
+class CopyStrings : public ghjson::Handler
+{
+    public:
+        string out;
+        bool on_string(std::string_view value) override
+        {
+            out.assign(value.data(), value.size());
+            return true;
+        }
+};
+
+void BenchString()
+{
+    cout << "== string array: scanner (parseSax into one buffer) vs legacy loop, full parse for reference ==" << endl;
+    struct { const char * name; size_t escapeEvery; } kinds[] = {{"plain", 0}, {"escape/64", 64}, {"escape/4", 4}, {"escape/2", 2}};
+    for(auto kind : kinds)
+    {
+        string in = MakeStringArray(20000, 256, kind.escapeEvery);
+        double mb = in.size() / 1e6;
+        CopyStrings handler;
+        double saxMs = TimeMs([&]{ ghjson::parseSax(in, handler); }, 5);
+        double legacyMs = TimeMs([&]
+        {
+            size_t idx = 1;
+            string out;
+            while(in[idx] == '"')
+            {
+                out.clear();
+                idx = LegacyParseString(in, idx, out);
+                if(in[idx] == ',')
+                    idx++;
+            }
+        }, 5);
+        double treeMs = TimeMs([&]{ ghjson::parse(in); }, 5);
+        cout << setw(10) << kind.name << ": scanner " << setw(7) << mb / (saxMs / 1e3) << " MB/s, legacy loop "
+             << setw(7) << mb / (legacyMs / 1e3) << " MB/s | parse to tree " << setw(7) << mb / (treeMs / 1e3) << " MB/s" << endl;
+    }
+}
+
+//只累加"score"字段
+class ScoreSum : public ghjson::Handler
+{
+    public:
+        bool   next = false;
+        double sum = 0;
+        bool on_key(std::string_view key) override { next = key == "score"; return true; }
+        bool on_number(double value) override
+        {
+            if(next)
+                sum += value;
+            return true;
+        }
+};
+
+void BenchSax()
+{
+    cout << "== sum one field: SAX vs tree ==" << endl;
+    for(size_t n : {10000, 100000})
+    {
+        string in = MakePayload(n);
+        double mb = in.size() / 1e6;
+        size_t before = allocations;
+        ScoreSum handler;
+        double saxMs = TimeMs([&]{ ghjson::parseSax(in, handler); }, 3);
+        size_t saxAllocs = (allocations - before) / 3;
+
+        before = allocations;
+        double treeMs = TimeMs([&]
+        {
+            double sum = 0;
+            ghjson::Json json = ghjson::parse(in);
+            for(auto iter = json.arrayBegin_const(); iter != json.arrayEnd_const(); ++iter)
+                sum += (*iter)["score"].getNumber();
+        }, 3);
+        size_t treeAllocs = (allocations - before) / 3;
+        cout << setw(7) << n << " records: SAX " << setw(7) << mb / (saxMs / 1e3) << " MB/s, " << setw(7) << saxAllocs << " allocs | "
+             << "tree " << setw(7) << mb / (treeMs / 1e3) << " MB/s, " << setw(8) << treeAllocs << " allocs" << endl;
+    }
+}
+
+void BenchStream()
+{
+    cout << "== 16KB socket reads: StreamParser vs buffer then parse ==" << endl;
+    string in = MakeApiResponse(20000);
+    const size_t chunk = 16 * 1024;
+    double mb = in.size() / 1e6;
+    double bufferMs = TimeMs([&]
+    {
+        string body;
+        for(size_t i = 0; i < in.size(); i += chunk)
+            body.append(in, i, chunk);
+        ghjson::parse(body);
+    }, 3);
+    double streamMs = TimeMs([&]
+    {
+        ghjson::StreamParser parser;
+        for(size_t i = 0; i < in.size(); i += chunk)
+            parser.feed(in.data() + i, min(chunk, in.size() - i));
+        parser.finish();
+        parser.result();
+    }, 3);
+    ScoreSum handler;
+    double saxMs = TimeMs([&]
+    {
+        ghjson::StreamParser parser(handler);
+        for(size_t i = 0; i < in.size(); i += chunk)
+            parser.feed(in.data() + i, min(chunk, in.size() - i));
+        parser.finish();
+    }, 3);
+    cout << "buffer + parse " << setw(7) << mb / (bufferMs / 1e3) << " MB/s | stream to Json " << setw(7) << mb / (streamMs / 1e3)
+         << " MB/s | stream to Handler " << setw(7) << mb / (saxMs / 1e3) << " MB/s" << endl;
+}
+
+void BenchNdjson()
+{
+    cout << "== ndjson, 200000 log records (" << thread::hardware_concurrency() << " hardware threads) ==" << endl;
+    string in;
+    for(size_t i = 0; i < 200000; i++)
+        in += "{\"ts\": " + to_string(1700000000 + i) + ", \"level\": \"info\", \"msg\": \"request served in " + to_string(i % 500)
+            + " ms\", \"tags\": [\"api\", \"v2\"], \"ok\": true}\n";
+    double mb = in.size() / 1e6;
+    double lineMs = TimeMs([&]
+    {
+        vector<ghjson::Json> out;
+        size_t start = 0;
+        while(start < in.size())
+        {
+            size_t end = in.find('\n', start);
+            out.push_back(ghjson::parse(in.substr(start, end - start)));
+            start = end + 1;
+        }
+    }, 3);
+    cout << "parse per line: " << setw(7) << mb / (lineMs / 1e3) << " MB/s" << endl;
+    for(size_t threads : {1, 2, 4, 8})
+    {
+        double ms = TimeMs([&]{ ghjson::parseNdjson(in, threads); }, 3);
+        cout << setw(2) << threads << " threads     : " << setw(7) << mb / (ms / 1e3) << " MB/s, x" << lineMs / ms << endl;
+    }
+}
+
+#if defined(__unix__)
+//在子进程里跑，单独得到每种方式的峰值RSS
+template<typename F>
+void RunChild(const char * name, F && f)
+{
+    auto start = chrono::steady_clock::now();
+    pid_t pid = fork();
+    if(pid == 0)
+    {
+        f();
+        _exit(0);
+    }
+    int status = 0;
+    struct rusage usage;
+    wait4(pid, &status, 0, &usage);
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cout << setw(16) << name << ": " << setw(9) << ms << " ms, peak RSS " << setw(7) << usage.ru_maxrss / 1024.0 << " MB" << endl;
+}
+
+void BenchFile()
+{
+    const char * path = "ghjson_bench_file.json";
+    string content = MakeApiResponse(200000);
+    FILE * file = fopen(path, "wb");
+    fwrite(content.data(), 1, content.size(), file);
+    fclose(file);
+    size_t size = content.size();
+    string().swap(content);
+
+    cout << "== " << size / 1000000.0 << " MB file: read then parse vs parseFile ==" << endl;
+    RunChild("read + parse", [&]
+    {
+        FILE * in = fopen(path, "rb");
+        string data(size, '\0');
+        size_t n = fread(&data[0], 1, size, in);
+        fclose(in);
+        data.resize(n);
+        ghjson::parse(data);
+    });
+    RunChild("stringstream", [&]
+    {
+        ifstream in(path, ios::binary);
+        stringstream buffer;
+        buffer << in.rdbuf();
+        string data = buffer.str();
+        ghjson::parse(data);
+    });
+    RunChild("parseFile", [&]{ ghjson::parseFile(path); });
+    remove(path);
+}
+
+void BenchSink()
+{
+    ghjson::Json json = ghjson::parse(MakeApiResponse(100000));
+    cout << "== serialize " << json.dump().size() / 1000000.0 << " MB to /dev/null ==" << endl;
+    RunChild("tree only", [&]{});
+    RunChild("dump + write", [&]
+    {
+        int fd = open("/dev/null", O_WRONLY);
+        string out = json.dump();
+        ssize_t n = write(fd, out.data(), out.size());
+        (void)n;
+        close(fd);
+    });
+    RunChild("dumpTo(fd)", [&]
+    {
+        int fd = open("/dev/null", O_WRONLY);
+        json.dumpTo(fd);
+        close(fd);
+    });
+}
+#else
+void BenchFile() {}
+void BenchSink() {}
+#endif
+
+//旧的dump: to_string、临时字符串拼接、逐段 +=
+void LegacyDump(const ghjson::Json & json, string & out, size_t depth)
+{
+    switch(json.type())
+    {
+        case ghjson::JsonType::NUL:    out += "null"; break;
+        case ghjson::JsonType::BOOL:   out += (json.getBool() ? "true" : "false"); break;
+        case ghjson::JsonType::NUMBER: out += to_string(json.getNumber()); break;
+        case ghjson::JsonType::STRING: out += "\"" + json.getString() + "\""; break;
+        case ghjson::JsonType::ARRAY:
+        {
+            out += '[';
+            bool first = true;
+            for(auto iter = json.arrayBegin_const(); iter != json.arrayEnd_const(); ++iter)
+            {
+                if(!first)
+                    out += ", ";
+                first = false;
+                LegacyDump(*iter, out, depth + 1);
+            }
+            out += ']';
+            break;
+        }
+        case ghjson::JsonType::OBJECT:
+        {
+            out += '{';
+            bool first = true;
+            for(auto iter = json.objectBegin_const(); iter != json.objectEnd_const(); ++iter)
+            {
+                if(!first)
+                {
+                    out += ",\n";
+                    for(size_t i = 0; i < depth; i++)
+                        out += '\t';
+                }
+                first = false;
+                out += iter->first + " : ";
+                LegacyDump(iter->second, out, depth + 1);
+            }
+            out += '}';
+            break;
+        }
+    }
+}
+
+void RunDump(const char * name, const ghjson::Json & json)
+{
+    ghjson::DumpOptions pretty;
+    pretty.pretty = true;
+    size_t bytes = 0, prettyBytes = 0, legacyBytes = 0;
+    double ms = TimeMs([&]{ bytes = json.dump().size(); }, 5);
+    double prettyMs = TimeMs([&]{ prettyBytes = json.dump(pretty).size(); }, 5);
+    double legacyMs = TimeMs([&]{ string out; LegacyDump(json, out, 0); legacyBytes = out.size(); }, 5);
+    cout << setw(8) << name << ": compact " << setw(9) << bytes << " B " << setw(8) << ms << " ms | pretty " << setw(9) << prettyBytes << " B "
+         << setw(8) << prettyMs << " ms | legacy dump " << setw(9) << legacyBytes << " B " << setw(8) << legacyMs << " ms" << endl;
+}
+
+void BenchDump()
+{
+    cout << "== dump ==" << endl;
+    RunDump("numbers", ghjson::parse(MakeNumberArray(200000)));
+    RunDump("records", ghjson::parse(MakePayload(50000)));
+    RunDump("api", ghjson::parse(MakeApiResponse(20000)));
+}
+
+//事件流: 每条记录都是同样的30个键
+string MakeEvents(size_t n)
+{
+    string out = "[";
+    for(size_t i = 0; i < n; i++)
+    {
+        out += i ? ",{" : "{";
+        for(size_t k = 0; k < 30; k++)
+        {
+            if(k)
+                out += ',';
+            out += "\"event_field_name_" + to_string(k) + "\":" + to_string(i * 30 + k);
+        }
+        out += '}';
+    }
+    out += ']';
+    return out;
+}
+
+void BenchKeyPool()
+{
+    cout << "== key interning, 30 keys per record ==" << endl;
+    for(size_t n : {1000, 10000, 100000})
+    {
+        string in = MakeEvents(n);
+        ghjson::Document plain;
+        size_t plainBytes = 0;
+        double plainMs = TimeMs([&]{ plain.parse(in); plainBytes = plain.memoryUsage(); }, 3);
+
+        ghjson::KeyPool keys;
+        for(size_t k = 0; k < 30; k++)
+            keys.seed("event_field_name_" + to_string(k));
+        keys.freeze();
+        ghjson::Document pooled;
+        pooled.setKeyPool(&keys);
+        size_t pooledBytes = 0;
+        double pooledMs = TimeMs([&]{ pooled.parse(in); pooledBytes = pooled.memoryUsage(); }, 3);
+
+        //每条记录取最后一个字段
+        string name = "event_field_name_29";
+        std::string_view interned = keys.find(name);
+        double sum = 0;
+        double lookupMs = TimeMs([&]{ for(size_t i = 0; i < n; i++) sum += plain[i][name].getNumber(); }, 3);
+        double internedMs = TimeMs([&]{ for(size_t i = 0; i < n; i++) sum += pooled[i][interned].getNumber(); }, 3);
+
+        cout << setw(7) << n << " records: plain " << setw(9) << plainMs << " ms, " << setw(9) << plainBytes << " bytes | pooled "
+             << setw(9) << pooledMs << " ms, " << setw(9) << pooledBytes << " bytes, hit rate " << keys.hitRate()
+             << " | lookup plain " << setw(8) << lookupMs << " ms, interned " << setw(8) << internedMs << " ms" << (sum < 0 ? "!" : "") << endl;
+    }
+}
+
+//大文档里只取三个字段: 完整parse 对比 parseLazy
+void BenchLazy()
+{
+    cout << "== lazy field extraction, 3 fields ==" << endl;
+    for(size_t n : {100, 1000, 10000})
+    {
+        string in = "{\"meta\": {\"version\": 3, \"source\": \"bench\"}, \"payload\": " + MakeApiResponse(n) + ", \"status\": \"ok\", \"total\": " + to_string(n) + "}";
+        size_t sum = 0;
+        size_t before = allocations;
+        double parseMs = TimeMs([&]
+        {
+            ghjson::Json json = ghjson::parse(in);
+            sum += size_t(json["meta"]["version"].getNumber()) + json["status"].getString().size() + size_t(json["total"].getNumber());
+        }, 10);
+        size_t parseAllocs = (allocations - before) / 10;
+        before = allocations;
+        double lazyMs = TimeMs([&]
+        {
+            ghjson::LazyValue root = ghjson::parseLazy(in);
+            sum += size_t(root["meta"]["version"].getNumber()) + root["status"].getString().size() + size_t(root["total"].getNumber());
+        }, 10);
+        size_t lazyAllocs = (allocations - before) / 10;
+        cout << setw(9) << in.size() << " bytes: parse " << setw(9) << parseMs << " ms, " << setw(7) << parseAllocs << " allocs | lazy "
+             << setw(9) << lazyMs << " ms, " << setw(3) << lazyAllocs << " allocs" << (sum == 0 ? "!" : "") << endl;
+    }
+}
+
+//宽记录: 每条40个字段，只保留其中2个(5%)
+string MakeWide(size_t n)
+{
+    string out = "{\"data\": [";
+    for(size_t i = 0; i < n; i++)
+    {
+        out += i ? ",{" : "{";
+        for(size_t k = 0; k < 40; k++)
+        {
+            if(k)
+                out += ',';
+            out += "\"field" + to_string(k) + "\":";
+            switch(k % 4)
+            {
+                case 0: out += to_string(i * 40 + k); break;
+                case 1: out += "\"value of a moderately long string field " + to_string(k) + "\""; break;
+                case 2: out += "[1.5, true, \"x\"]"; break;
+                case 3: out += "{\"nested\": " + to_string(k) + "}"; break;
+            }
+        }
+        out += '}';
+    }
+    out += "]}";
+    return out;
+}
+
+void BenchProjection()
+{
+    cout << "== projection, keep 2 of 40 fields ==" << endl;
+    ghjson::Projection projection{"/data/field0", "/data/field1"};
+    ghjson::ParseOptions options;
+    options.projection = &projection;
+    for(size_t n : {1000, 10000, 50000})
+    {
+        string in = MakeWide(n);
+        size_t before = allocations;
+        double fullMs = TimeMs([&]{ ghjson::parse(in); }, 3);
+        size_t fullAllocs = (allocations - before) / 3;
+        before = allocations;
+        size_t kept = 0;
+        double projectedMs = TimeMs([&]{ kept = ghjson::parse(in, options).dump().size(); }, 3);
+        size_t projectedAllocs = (allocations - before) / 3;
+        cout << setw(9) << in.size() << " bytes: full " << setw(9) << fullMs << " ms, " << setw(8) << fullAllocs << " allocs | projected "
+             << setw(9) << projectedMs << " ms, " << setw(7) << projectedAllocs << " allocs, " << kept << " bytes kept" << endl;
+    }
+#if defined(__unix__)
+    string in = MakeWide(50000);
+    RunChild("full parse", [&]{ ghjson::Json json = ghjson::parse(in); string().swap(in); });
+    RunChild("projected parse", [&]{ ghjson::Json json = ghjson::parse(in, options); string().swap(in); });
+#endif
+}
+
+//每条消息都读同几个嵌套字段: 链式operator[] 对比预编译的JsonPath
+void BenchPath()
+{
+    cout << "== JSON Pointer vs chained operator[], 1M lookups ==" << endl;
+    string in = "{\"id\": 42, \"request\": {\"method\": \"GET\", \"path\": \"/index.html\", \"headers\": {"
+                "\"accept\": \"*/*\", \"accept-encoding\": \"gzip\", \"connection\": \"keep-alive\", \"cookie\": \"a=b\","
+                "\"host\": \"example.com\", \"user-agent\": \"bench\", \"x-request-id\": \"abc\"}},"
+                "\"items\": [{\"sku\": \"a\", \"qty\": 1}, {\"sku\": \"b\", \"qty\": 2}]}";
+    ghjson::Json json = ghjson::parse(in);
+    const ghjson::Json & message = json;
+    const int n = 1000000;
+    size_t sum = 0;
+
+    double chainedMs = TimeMs([&]
+    {
+        for(int i = 0; i < n; i++)
+            sum += message["request"]["headers"]["host"].getString().size() + size_t(message["items"][1]["qty"].getNumber());
+    });
+    ghjson::JsonPath host("/request/headers/host"), qty("/items/1/qty");
+    double pathMs = TimeMs([&]
+    {
+        for(int i = 0; i < n; i++)
+            sum += host.find(message)->getString().size() + size_t(qty.find(message)->getNumber());
+    });
+
+    //字段不存在: operator[]只能靠异常
+    double chainedMissMs = TimeMs([&]
+    {
+        for(int i = 0; i < n / 10; i++)
+        {
+            try { sum += message["request"]["headers"]["x-missing"].getString().size(); }
+            catch(const ghjson::ghJsonException &) { sum++; }
+        }
+    }) * 10;
+    ghjson::JsonPath missing("/request/headers/x-missing");
+    double pathMissMs = TimeMs([&]
+    {
+        for(int i = 0; i < n; i++)
+            sum += missing.find(message) == nullptr;
+    });
+
+    ghjson::Document doc = ghjson::parseDocument(in);
+    double docChainedMs = TimeMs([&]
+    {
+        for(int i = 0; i < n; i++)
+            sum += doc["request"]["headers"]["host"].getString().size() + size_t(doc["items"][1]["qty"].getNumber());
+    });
+    double docPathMs = TimeMs([&]
+    {
+        for(int i = 0; i < n; i++)
+            sum += host.find(doc).getString().size() + size_t(qty.find(doc).getNumber());
+    });
+
+    cout << "Json:     chained " << setw(8) << chainedMs << " ms, path " << setw(8) << pathMs << " ms | missing: chained+catch "
+         << setw(8) << chainedMissMs << " ms, path " << setw(8) << pathMissMs << " ms" << endl;
+    cout << "Document: chained " << setw(8) << docChainedMs << " ms, path " << setw(8) << docPathMs << " ms" << (sum == 0 ? "!" : "") << endl;
+}
+
+//插入: 按打乱的顺序逐个emplace；查找: 每个key查一次；遍历: 累加所有value。单位都是每个元素的ns
+template<typename M>
+void RunObject(const char * name, const vector<string> & keys, bool insertOnly)
+{
+    size_t n = keys.size();
+    int repeat = int(max<size_t>(1, 1000000 / n));
+    double insertNs = 0;
+    M values;
+    if(insertOnly)
+    {
+        insertNs = TimeMs([&]
+        {
+            M fresh;
+            for(size_t i = 0; i < n; i++)
+                fresh.emplace(keys[i], ghjson::Json(int(i)));
+            values = move(fresh);
+        }, repeat) * 1e6 / n;
+    }
+    else
+        for(size_t i = 0; i < n; i++)
+            values.emplace(keys[i], ghjson::Json(int(i)));
+
+    double sum = 0;
+    double lookupNs = TimeMs([&]
+    {
+        for(const auto & key : keys)
+            sum += values.find(key)->second.getNumber();
+    }, repeat) * 1e6 / n;
+    double iterateNs = TimeMs([&]
+    {
+        for(const auto & item : values)
+            sum += item.second.getNumber();
+    }, repeat) * 1e6 / n;
+
+    cout << "  " << setw(8) << name << ": insert ";
+    if(insertOnly)
+        cout << setw(8) << insertNs;
+    else
+        cout << setw(8) << "-";
+    cout << " ns, lookup " << setw(8) << lookupNs << " ns, iterate " << setw(8) << iterateNs << " ns" << (sum < 0 ? "!" : "") << endl;
+}
+
+void BenchObject()
+{
+    cout << "== object backends, ns per element ==" << endl;
+    mt19937 rng(1);
+    for(size_t n : {4, 16, 64, 256, 1024, 10000, 100000})
+    {
+        vector<string> keys;
+        for(size_t i = 0; i < n; i++)
+            keys.push_back("field_" + to_string(i));
+        shuffle(keys.begin(), keys.end(), rng);
+        cout << n << " keys" << endl;
+        RunObject<map<string, ghjson::Json>>("map", keys, true);
+        //乱序逐个插入有序vector是O(n^2)，太大时只测查找和遍历(解析时是整体排序一次)
+        RunObject<ghjson::FlatMap<ghjson::Json>>("flat", keys, n <= 10000);
+        RunObject<ghjson::HashMap<ghjson::Json>>("hash", keys, true);
+        RunObject<ghjson::OrderedMap<ghjson::Json>>("ordered", keys, true);
+    }
+}
+
+//解析/输出/析构都改成显式栈后，浅层文档不应变慢；深层文档只受max_depth限制
+void RunShallow(const char * name, const string & in)
+{
+    ghjson::ParseOptions structural;
+    structural.structural_index = true;
+    ghjson::Json json = ghjson::parse(in);
+    double parseMs = TimeMs([&]{ ghjson::parse(in); }, 5);
+    double twoStageMs = TimeMs([&]{ ghjson::parse(in, structural); }, 5);
+    double dumpMs = TimeMs([&]{ json.dump(); }, 5);
+    double destroyMs = 0;
+    for(int i = 0; i < 5; i++)
+    {
+        ghjson::Json tmp = ghjson::parse(in);
+        destroyMs += TimeMs([&]{ tmp = ghjson::Json(); }) / 5;
+    }
+    cout << setw(8) << name << ": parse " << setw(8) << parseMs << " ms | two-stage " << setw(8) << twoStageMs << " ms | dump "
+         << setw(8) << dumpMs << " ms | destroy " << setw(8) << destroyMs << " ms" << endl;
+}
+
+void BenchDepth()
+{
+    cout << "== shallow documents ==" << endl;
+    RunShallow("records", MakePayload(100000));
+    RunShallow("api", MakeApiResponse(50000));
+    RunShallow("nested", MakeNested(10));
+
+    cout << "== deep documents (max_depth raised) ==" << endl;
+    for(size_t depth : {1000, 100000, 1000000})
+    {
+        string in = string(depth, '[') + "1" + string(depth, ']');
+        ghjson::ParseOptions options;
+        options.max_depth = depth;
+        ghjson::Json json;
+        double parseMs = TimeMs([&]{ json = ghjson::parse(in, options); });
+        double dumpMs = TimeMs([&]{ json.dump(); });
+        double destroyMs = TimeMs([&]{ json = ghjson::Json(); });
+        cout << "depth " << setw(8) << depth << ": parse " << setw(8) << parseMs << " ms | dump " << setw(8) << dumpMs
+             << " ms | destroy " << setw(8) << destroyMs << " ms" << endl;
+    }
+}
+
+//拒绝不合法输入: 异常路径和错误码路径
+void RunInvalid(const char * name, const string & in)
+{
+    const int n = 20000;
+    size_t rejected = 0;
+    size_t before = allocations;
+    double throwMs = TimeMs([&]
+    {
+        for(int i = 0; i < n; i++)
+        {
+            try { ghjson::parse(in); }
+            catch(const ghjson::ghJsonException &) { rejected++; }
+        }
+    });
+    size_t throwAllocs = allocations - before;
+
+    before = allocations;
+    double codeMs = TimeMs([&]
+    {
+        ghjson::Json out;
+        ghjson::ParseError err;
+        for(int i = 0; i < n; i++)
+            rejected += !ghjson::parse(in, out, err);
+    });
+    size_t codeAllocs = allocations - before;
+    if(rejected != 2 * n)
+        cout << name << ": input was accepted" << endl;
+    cout << setw(8) << name << ": exception " << setw(8) << n / throwMs / 1e3 << " M/s, " << setw(5) << double(throwAllocs) / n << " allocs | error code "
+         << setw(8) << n / codeMs / 1e3 << " M/s, " << setw(5) << double(codeAllocs) / n << " allocs" << endl;
+}
+
+void BenchInvalid()
+{
+    cout << "== reject invalid input, per document ==" << endl;
+    RunInvalid("early", "{\"id\": tru, \"name\": \"user\"}");
+    string late = MakePayload(20);
+    late[late.rfind(':')] = ' ';
+    RunInvalid("late", late);
+    RunInvalid("deep", string(30, '[') + "1 2" + string(30, ']'));
+    string nested = MakeNested(12);
+    nested.replace(nested.rfind("1.5"), 3, "1.x");
+    RunInvalid("nested", nested);
+}
+
+//64位ID和计数器: 小整数、超过2^53的ID各一半
+string MakeIntegerArray(size_t n)
+{
+    string out = "[";
+    mt19937_64 rng(7);
+    for(size_t i = 0; i < n; i++)
+    {
+        if(i)
+            out += ',';
+        out += i % 2 ? to_string(rng() >> 1) : to_string(i);
+    }
+    out += ']';
+    return out;
+}
+
+//金额: 两位小数，需要原样保留
+string MakePrices(size_t n)
+{
+    string out = "[";
+    for(size_t i = 0; i < n; i++)
+    {
+        if(i)
+            out += ',';
+        out += to_string(i % 10000) + "." + to_string(10 + i % 90);
+    }
+    out += ']';
+    return out;
+}
+
+void RunInteger(const char * name, const string & in, const ghjson::ParseOptions & options, size_t n)
+{
+    ghjson::Json json;
+    double parseMs = TimeMs([&]{ json = ghjson::parse(in, options); }, 5);
+    string out;
+    double dumpMs = TimeMs([&]{ out = json.dump(); }, 5);
+    cout << setw(8) << name << ": parse " << setw(8) << parseMs << " ms " << setw(6) << parseMs * 1e6 / n << " ns/number | dump "
+         << setw(8) << dumpMs << " ms " << setw(6) << dumpMs * 1e6 / n << " ns/number | round trip " << (out == in ? "exact" : "lossy") << endl;
+}
+
+void BenchInteger()
+{
+    cout << "== integers and raw numbers, 500000 per array ==" << endl;
+    const size_t n = 500000;
+    ghjson::ParseOptions options;
+    RunInteger("ids", MakeIntegerArray(n), options, n);
+    RunInteger("prices", MakePrices(n), options, n);
+    options.raw_numbers = true;
+    RunInteger("raw", MakePrices(n), options, n);
+}
+
+//请求循环: 大量形状相似的小文档，每个用完就丢
+void RunReuse(const char * name, const vector<string> & docs, const ghjson::ParseOptions & options)
+{
+    const size_t rounds = 20000;
+    size_t fresh = 0, reused = 0;
+    double freshMs = TimeMs([&]{
+        size_t before = allocations;
+        for(size_t i = 0; i < rounds; i++)
+            ghjson::parse(docs[i % docs.size()], options);
+        fresh = allocations - before;
+    });
+    ghjson::Parser parser(options);
+    ghjson::Json out;
+    ghjson::ParseError err;
+    for(const auto & doc : docs)
+        parser.parse(doc, out, err);
+    double reuseMs = TimeMs([&]{
+        size_t before = allocations;
+        for(size_t i = 0; i < rounds; i++)
+            parser.parse(docs[i % docs.size()], out, err);
+        reused = allocations - before;
+    });
+    cout << setw(10) << name << ": parse " << setw(8) << freshMs * 1e3 / rounds << " us/doc " << setw(6) << double(fresh) / rounds << " allocs/doc | Parser "
+         << setw(8) << reuseMs * 1e3 / rounds << " us/doc " << setw(6) << double(reused) / rounds << " allocs/doc" << endl;
+}
+
+void BenchReuse()
+{
+    cout << "== reused Parser, 20000 documents ==" << endl;
+    vector<string> payloads, responses;
+    for(size_t i = 0; i < 16; i++)
+    {
+        payloads.push_back(MakePayload(8 + i % 4));
+        responses.push_back(MakeApiResponse(4 + i % 3));
+    }
+    ghjson::ParseOptions options;
+    RunReuse("payload", payloads, options);
+    RunReuse("response", responses, options);
+    options.structural_index = true;
+    RunReuse("two-stage", responses, options);
+}
+
+//每个文档解析完就整体丢弃: 默认资源逐个释放，monotonic只在文档结束时把缓冲退回起点
+//资源只管节点和容器；allocs/doc是全局operator new的次数，monotonic/pool下剩下的是放不进内联缓冲的字符串和键
+void RunResource(const char * name, const vector<string> & docs)
+{
+    const size_t rounds = 20000;
+    auto run = [&](const char * label, std::pmr::memory_resource * resource, auto && reset)
+    {
+        ghjson::ParseOptions options;
+        options.resource = resource;
+        size_t allocs = 0;
+        double ms = TimeMs([&]{
+            size_t before = allocations;
+            for(size_t i = 0; i < rounds; i++)
+            {
+                ghjson::parse(docs[i % docs.size()], options);
+                reset();
+            }
+            allocs = allocations - before;
+        });
+        cout << setw(10) << name << " " << setw(9) << label << ": " << setw(8) << ms * 1e3 / rounds << " us/doc "
+             << setw(6) << double(allocs) / rounds << " allocs/doc" << endl;
+    };
+    run("default", nullptr, []{});
+    vector<char> buffer(256 * 1024);
+    std::pmr::monotonic_buffer_resource monotonic(buffer.data(), buffer.size());
+    run("monotonic", &monotonic, [&]{ monotonic.release(); });
+    std::pmr::unsynchronized_pool_resource pool;
+    run("pool", &pool, []{});
+}
+
+void BenchResource()
+{
+    cout << "== memory resource (nodes and containers only; long strings and keys stay on the heap), 20000 documents ==" << endl;
+    vector<string> payloads, responses;
+    for(size_t i = 0; i < 16; i++)
+    {
+        payloads.push_back(MakePayload(8 + i % 4));
+        responses.push_back(MakeApiResponse(4 + i % 3));
+    }
+    RunResource("payload", payloads);
+    RunResource("response", responses);
+}
+
+struct Bench
+{
+    const char * name;
+    void (*run)();
+};
+
+const Bench benches[] =
+{
+    {"number", BenchNumber},
+    {"document", BenchDocument},
+    {"layout", BenchLayout},
+    {"nested", BenchNested},
+    {"copy", BenchCopy},
+    {"structural", BenchStructural},
+    {"string", BenchString},
+    {"sax", BenchSax},
+    {"stream", BenchStream},
+    {"ndjson", BenchNdjson},
+    {"file", BenchFile},
+    {"dump", BenchDump},
+    {"sink", BenchSink},
+    {"object", BenchObject},
+    {"keys", BenchKeyPool},
+    {"path", BenchPath},
+    {"lazy", BenchLazy},
+    {"projection", BenchProjection},
+    {"depth", BenchDepth},
+    {"invalid", BenchInvalid},
+    {"integer", BenchInteger},
+    {"reuse", BenchReuse},
+    {"pmr", BenchResource},
+};
+
+int main(int argc, char * argv[])
+{
+    for(const auto & bench : benches)
+    {
+        bool selected = argc < 2;
+        for(int i = 1; i < argc; i++)
+            selected = selected || strcmp(argv[i], bench.name) == 0;
+        if(selected)
+            bench.run();
+    }
+    return 0;
+}
@@ -1,616 +1,4721 @@
 #include "ghjson.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <atomic>
+#include <iterator>
+#include <type_traits>
+#include <thread>
+#include <exception>
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <ostream>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define GHJSON_POSIX_FILE 1
+#else
+#include <fstream>
+#endif
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace ghjson
 {
-    template<JsonType tag, typename T>
-    class Value : public JsonValue
-    {
-        protected:
-            T m_value;
-            //constructor
-            explicit Value(const T &value) : m_value(value) {}
-            explicit Value(T &&value)      : m_value(std::move(value)) {}
-            //constructor
-            //type
-            JsonType type() const override { return tag; }
-            //type
-            //getvalue
-            double              getNumber() const override { throw ghJsonException("Invalid type:  Attempted to call " + std::string(__func__) + " on a JsonValue of type " + ToString(type()), 0); }
-            bool                getBool  () const override { throw ghJsonException("Invalid type:  Attempted to call " + std::string(__func__) + " on a JsonValue of type " + ToString(type()), 0); }
-            const std::string & getString() const override { throw ghJsonException("Invalid type:  Attempted to call " + std::string(__func__) + " on a JsonValue of type " + ToString(type()), 0); }
-            const array &       getArray () const override { throw ghJsonException("Invalid type:  Attempted to call " + std::string(__func__) + " on a JsonValue of type " + ToString(type()), 0); }
-            const object &      getObject() const override { throw ghJsonException("Invalid type:  Attempted to call " + std::string(__func__) + " on a JsonValue of type " + ToString(type()), 0); }
-            //getvalue
-            //operator[]
-            Json& operator[](size_t index) override { throw ghJsonException("Invalid type:  Attempted to call " + std::string(__func__) + " on a JsonValue of type " + ToString(type()), 0); }
-            Json& operator[](const std::string& key) override { throw ghJsonException("Invalid type:  Attempted to call " + std::string(__func__) + " on a JsonValue of type " + ToString(type()), 0); }
-            const Json& operator[](size_t index) const  override { throw ghJsonException("Invalid type:  Attempted to call " + std::string(__func__) + " on a JsonValue of type " + ToString(type()), 0); }
-            const Json& operator[](const std::string& key) const override { throw ghJsonException("Invalid type:  Attempted to call " + std::string(__func__) + " on a JsonValue of type " + ToString(type()), 0); }
-            //operator[]
-            //setvalue
-            void setNumber (double               value) override { throw ghJsonException("Invalid type:  Attempted to call " + std::string(__func__) + " on a JsonValue of type " + ToString(type()), 0); }
-            void setBool   (bool                 value) override { throw ghJsonException("Invalid type:  Attempted to call " + std::string(__func__) + " on a JsonValue of type " + ToString(type()), 0); }
-            void setString (const  std::string & value) override { throw ghJsonException("Invalid type:  Attempted to call " + std::string(__func__) + " on a JsonValue of type " + ToString(type()), 0); }
-            void setArray  (const  array       & value) override { throw ghJsonException("Invalid type:  Attempted to call " + std::string(__func__) + " on a JsonValue of type " + ToString(type()), 0); }
-            void setObject (const  object      & value) override { throw ghJsonException("Invalid type:  Attempted to call " + std::string(__func__) + " on a JsonValue of type " + ToString(type()), 0); }
-
-            void addToArray (const Json & value) override { throw ghJsonException("Invalid type:  Attempted to call " + std::string(__func__) + " on a JsonValue of type " + ToString(type()), 0); }
-            void addToObject(const std::string & key, const Json & value) override { throw ghJsonException("Invalid type:  Attempted to call " + std::string(__func__) + " on a JsonValue of type " + ToString(type()), 0); }
-
-            void removeFromArray(size_t index) override { throw ghJsonException("Invalid type:  Attempted to call " + std::string(__func__) + " on a JsonValue of type " + ToString(type()), 0); }
-            void removeFromObject(const std::string& key) override { throw ghJsonException("Invalid type:  Attempted to call " + std::string(__func__) + " on a JsonValue of type " + ToString(type()), 0); }
-            //setvalue
-            //iterator
-            arrayiter arrayBegin() override { throw ghJsonException("Invalid type:  Attempted to call " + std::string(__func__) + " on a JsonValue of type " + ToString(type()), 0); };
-            const_arrayiter arrayBegin_const() const override { throw ghJsonException("Invalid type:  Attempted to call " + std::string(__func__) + " on a JsonValue of type " + ToString(type()), 0); };
-            arrayiter arrayEnd() override { throw ghJsonException("Invalid type:  Attempted to call " + std::string(__func__) + " on a JsonValue of type " + ToString(type()), 0); };
-            const_arrayiter arrayEnd_const() const override { throw ghJsonException("Invalid type:  Attempted to call " + std::string(__func__) + " on a JsonValue of type " + ToString(type()), 0); };
-            objectiter objectBegin() override { throw ghJsonException("Invalid type:  Attempted to call " + std::string(__func__) + " on a JsonValue of type " + ToString(type()), 0); };
-            const_objectiter objectBegin_const() const override { throw ghJsonException("Invalid type:  Attempted to call " + std::string(__func__) + " on a JsonValue of type " + ToString(type()), 0); };
-            objectiter objectEnd() override { throw ghJsonException("Invalid type:  Attempted to call " + std::string(__func__) + " on a JsonValue of type " + ToString(type()), 0); };
-            const_objectiter objectEnd_const() const override { throw ghJsonException("Invalid type:  Attempted to call " + std::string(__func__) + " on a JsonValue of type " + ToString(type()), 0); };
-            //iterator
-            //comparisons
-            bool equals(const JsonValue * other) const override { return m_value == static_cast<const Value<tag, T> *>(other)->m_value; }
-            bool less(const JsonValue * other) const  override { return m_value < static_cast<const Value<tag, T> *>(other)->m_value; }
-            //comparisons
+    //Json
+    [[noreturn]] void throwTypeError(const char * func, JsonType type)
+    {
+        throw ghJsonException("Invalid type:  Attempted to call " + std::string(func) + " on a JsonValue of type " + ToString(type), 0);
+    }
+
+    [[noreturn]] void throwRangeError(const char * func)
+    {
+        throw ghJsonException("Number out of range:  " + std::string(func) + " can not represent the value exactly", 0);
+    }
+
+    double rawToDouble(std::string_view text);
+
+    bool doubleToInt64(double value, int64_t & out)
+    {
+        if(!(value >= -9223372036854775808.0 && value < 9223372036854775808.0) || value != std::trunc(value))
+            return false;
+        out = int64_t(value);
+        return true;
+    }
+
+    bool doubleToUint64(double value, uint64_t & out)
+    {
+        if(!(value >= 0 && value < 18446744073709551616.0) || value != std::trunc(value))
+            return false;
+        out = uint64_t(value);
+        return true;
+    }
+
+    // 整数和double精确比较: 先比整数部分，相等时再看小数部分；返回-1/0/1，b是NaN时返回2
+    template<typename I>
+    int compareIntDouble(I a, double b)
+    {
+        if(std::isnan(b))
+            return 2;
+        const double limit = std::is_signed<I>::value ? 9223372036854775808.0 : 18446744073709551616.0;
+        if(b >= limit)
+            return -1;
+        if(b < (std::is_signed<I>::value ? -limit : 0.0))
+            return 1;
+        double whole = std::trunc(b);
+        if(a != I(whole))
+            return a < I(whole) ? -1 : 1;
+        return whole < b ? -1 : (whole > b ? 1 : 0);
+    }
+
+    // 数字按数值比较，和存储方式无关；返回-1/0/1，有NaN时返回2(既不相等也不小于)
+    int compareNumber(const Json & lhs, const Json & rhs)
+    {
+        NumberType a = lhs.numberType();
+        NumberType b = rhs.numberType();
+        auto floating = [](NumberType type) { return type == NumberType::DOUBLE || type == NumberType::RAW; };
+        if(floating(a) && floating(b))
+        {
+            if(a == NumberType::RAW && b == NumberType::RAW && lhs.getRawNumber() == rhs.getRawNumber())
+                return 0;
+            double x = lhs.getNumber();
+            double y = rhs.getNumber();
+            return x < y ? -1 : (x > y ? 1 : (x == y ? 0 : 2));
+        }
+        if(floating(a))
+        {
+            int result = compareNumber(rhs, lhs);
+            return result == 2 ? 2 : -result;
+        }
+        if(floating(b))
+            return a == NumberType::INT64 ? compareIntDouble(lhs.getInt64(), rhs.getNumber()) : compareIntDouble(lhs.getUint64(), rhs.getNumber());
+        if(a != b)
+            return a == NumberType::INT64 ? -1 : 1;     // UINT64都大于INT64_MAX
+        if(a == NumberType::INT64)
+            return lhs.getInt64() < rhs.getInt64() ? -1 : (lhs.getInt64() > rhs.getInt64() ? 1 : 0);
+        return lhs.getUint64() < rhs.getUint64() ? -1 : (lhs.getUint64() > rhs.getUint64() ? 1 : 0);
+    }
+
+    template<typename T>
+    struct Shared
+    {
+        std::atomic<size_t>         refs;
+        std::pmr::memory_resource * resource;   // 节点从这里分配；array/object的元素也用它
+        T value;
+        template<typename... Args>
+        explicit Shared(std::pmr::memory_resource * r, Args &&... args) : refs(1), resource(r), value(std::forward<Args>(args)...) {}
+    };
+
+    //std::pmr::new_delete_resource()不管对齐多少都调用带align_val_t的operator new，比普通的慢；
+    //默认对齐以内的改用普通的operator new，和用new创建节点时一样
+    class HeapResource : public std::pmr::memory_resource
+    {
+        private:
+            void * do_allocate(size_t bytes, size_t align) override
+            {
+                if(align <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+                    return ::operator new(bytes);
+                return ::operator new(bytes, std::align_val_t(align));
+            }
+            void do_deallocate(void * p, size_t bytes, size_t align) override
+            {
+                if(align <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+                    ::operator delete(p, bytes);
+                else
+                    ::operator delete(p, bytes, std::align_val_t(align));
+            }
+            bool do_is_equal(const std::pmr::memory_resource & other) const noexcept override { return this == &other; }
+    };
+    HeapResource g_heap;
+
+    // nullptr表示默认资源；默认资源没被换掉时用g_heap
+    std::pmr::memory_resource * resourceOr(std::pmr::memory_resource * resource)
+    {
+        if(!resource)
+            resource = std::pmr::get_default_resource();
+        return resource == std::pmr::new_delete_resource() ? &g_heap : resource;
+    }
+
+    template<typename T, typename... Args>
+    Shared<T> * makeShared(std::pmr::memory_resource * resource, Args &&... args)
+    {
+        void * p = resource->allocate(sizeof(Shared<T>), alignof(Shared<T>));
+        try
+        {
+            return new(p) Shared<T>(resource, std::forward<Args>(args)...);
+        }
+        catch(...)
+        {
+            resource->deallocate(p, sizeof(Shared<T>), alignof(Shared<T>));
+            throw;
+        }
+    }
+
+    // array/object的元素用节点所在的资源
+    template<typename T>
+    Shared<T> * makeContainer(std::pmr::memory_resource * resource)
+    {
+        return makeShared<T>(resource, typename T::allocator_type(resource));
+    }
+
+    template<typename T>
+    void destroyShared(Shared<T> * node) noexcept
+    {
+        if(!node)
+            return;
+        std::pmr::memory_resource * resource = node->resource;
+        node->~Shared<T>();
+        resource->deallocate(node, sizeof(Shared<T>), alignof(Shared<T>));
+    }
+
+    template<typename T>
+    Shared<T> * retain(Shared<T> * node)
+    {
+        node->refs.fetch_add(1, std::memory_order_relaxed);
+        return node;
+    }
+
+    template<typename T>
+    void release(Shared<T> * node)
+    {
+        if(node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            destroyShared(node);
+    }
+
+    // 容器节点不递归析构: 正在删除时新归零的子容器先挂到待删列表，由最外层的调用依次删除，
+    // 所以再深的嵌套也只占一层栈
+    struct PendingNode
+    {
+        Shared<array> *  items;
+        Shared<object> * members;
+    };
+    thread_local std::vector<PendingNode> t_pending;
+    thread_local bool t_draining = false;
+
+    void deleteNode(PendingNode node) noexcept
+    {
+        if(t_draining)
+        {
+            try
+            {
+                t_pending.push_back(node);
+                return;
+            }
+            catch(...) {} // 内存不足时直接删除
+            destroyShared(node.items);
+            destroyShared(node.members);
+            return;
+        }
+        t_draining = true;
+        while(true)
+        {
+            size_t first = t_pending.size();
+            destroyShared(node.items);
+            destroyShared(node.members);
+            // 子容器按原顺序释放，和递归析构一样，之后分配的内存布局不受影响
+            std::reverse(t_pending.begin() + first, t_pending.end());
+            if(t_pending.empty())
+                break;
+            node = t_pending.back();
+            t_pending.pop_back();
+        }
+        t_draining = false;
+    }
+
+    void release(Shared<array> * node)
+    {
+        if(node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            deleteNode(PendingNode{node, nullptr});
+    }
+
+    void release(Shared<object> * node)
+    {
+        if(node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            deleteNode(PendingNode{nullptr, node});
+    }
+
+    // 修改前调用: 节点被共享时在原来的资源里复制一份(浅拷贝，子节点仍然共享)
+    template<typename T>
+    T & mutate(Shared<T> *& node)
+    {
+        if(node->refs.load(std::memory_order_acquire) != 1)
+        {
+            Shared<T> * copy;
+            if constexpr(std::is_same_v<T, std::string>)
+                copy = makeShared<T>(node->resource, node->value);
+            else
+                copy = makeShared<T>(node->resource, node->value, typename T::allocator_type(node->resource));
+            release(node);
+            node = copy;
+        }
+        return node->value;
+    }
+
+    //解析时按输入顺序收集键值对，重复的key保留第一个(和std::map::emplace一致)
+    //FlatMap先全部收集再一次排序，避免逐个插入的O(n^2)
+    class ObjectBuilder
+    {
+        public:
+            explicit ObjectBuilder(std::pmr::memory_resource * resource)
+#if GHJSON_OBJECT_BACKEND == GHJSON_OBJECT_FLAT
+                : m_items(resource) {}
+#else
+                : m_out(object::allocator_type(resource)) {}
+#endif
+            // 接着用一个已经清空的object的容量(Parser回收的节点)；移动构造，资源跟着storage走
+            explicit ObjectBuilder(object && storage)
+#if GHJSON_OBJECT_BACKEND == GHJSON_OBJECT_FLAT
+                : m_items(std::move(storage.m_items)) {}
+#else
+                : m_out(std::move(storage)) {}
+#endif
+
+            // 元素和索引占用的容量，std::map没有预留的容量
+            static size_t capacity(const object & values)
+            {
+#if GHJSON_OBJECT_BACKEND == GHJSON_OBJECT_FLAT
+                return values.m_items.capacity();
+#elif GHJSON_OBJECT_BACKEND != GHJSON_OBJECT_MAP
+                return values.m_items.capacity() + values.m_slots.capacity();
+#else
+                (void)values;
+                return 0;
+#endif
+            }
+
+            void reserve(size_t n)
+            {
+#if GHJSON_OBJECT_BACKEND == GHJSON_OBJECT_FLAT
+                m_items.reserve(n);
+#elif GHJSON_OBJECT_BACKEND != GHJSON_OBJECT_MAP
+                m_out.reserve(n);
+#else
+                (void)n;
+#endif
+            }
+
+            void add(std::string && key, Json && value)
+            {
+#if GHJSON_OBJECT_BACKEND == GHJSON_OBJECT_FLAT
+                m_items.emplace_back(std::move(key), std::move(value));
+#else
+                m_out.emplace(std::move(key), std::move(value));
+#endif
+            }
+
+            object finish()
+            {
+#if GHJSON_OBJECT_BACKEND == GHJSON_OBJECT_FLAT
+                auto byKey = [](const object::value_type & a, const object::value_type & b) { return a.first < b.first; };
+                if(m_items.size() <= 16)
+                {
+                    // 小对象用插入排序，同样稳定，而且不像stable_sort那样申请临时缓冲
+                    for(size_t i = 1; i < m_items.size(); i++)
+                        for(size_t j = i; j > 0 && byKey(m_items[j], m_items[j - 1]); j--)
+                            std::swap(m_items[j], m_items[j - 1]);
+                }
+                else if(!std::is_sorted(m_items.begin(), m_items.end(), byKey))
+                    std::stable_sort(m_items.begin(), m_items.end(), byKey);
+                m_items.erase(std::unique(m_items.begin(), m_items.end(),
+                                          [](const object::value_type & a, const object::value_type & b) { return a.first == b.first; }),
+                              m_items.end());
+                return object(sorted_unique, std::move(m_items));
+#else
+                return std::move(m_out);
+#endif
+            }
+        private:
+#if GHJSON_OBJECT_BACKEND == GHJSON_OBJECT_FLAT
+            object::container_type m_items;
+#else
+            object m_out;
+#endif
+    };
+
+    //constructor
+    Json::Json() noexcept                : m_type(JsonType::NUL),    m_number(0) {}
+    Json::Json(std::nullptr_t) noexcept  : m_type(JsonType::NUL),    m_number(0) {}
+    Json::Json(int value) noexcept       : m_type(JsonType::NUMBER), m_numberType(NumberType::INT64), m_int(value) {}
+    Json::Json(long value) noexcept      : m_type(JsonType::NUMBER), m_numberType(NumberType::INT64), m_int(value) {}
+    Json::Json(long long value) noexcept : m_type(JsonType::NUMBER), m_numberType(NumberType::INT64), m_int(value) {}
+    Json::Json(unsigned value) noexcept  : m_type(JsonType::NUMBER), m_numberType(NumberType::INT64), m_int(value) {}
+    Json::Json(unsigned long value) noexcept      : Json((unsigned long long)value) {}
+    Json::Json(unsigned long long value) noexcept : m_type(JsonType::NUMBER), m_uint(value)
+    {
+        m_numberType = value > uint64_t(INT64_MAX) ? NumberType::UINT64 : NumberType::INT64;
+    }
+    Json::Json(double value) noexcept    : m_type(JsonType::NUMBER), m_number(value) {}
+    Json::Json(bool value) noexcept      : m_type(JsonType::BOOL),   m_bool(value) {}
+    Json::Json(const std::string &value) : Json(value, nullptr) {}
+    Json::Json(std::string &&value)      : Json(std::move(value), nullptr) {}
+    Json::Json(const char * value)       : Json(std::string(value), nullptr) {}
+    Json::Json(std::string value, std::pmr::memory_resource * resource)
+        : m_type(JsonType::STRING), m_string(makeShared<std::string>(resourceOr(resource), std::move(value))) {}
+    Json::Json(const array &values)      : m_type(JsonType::ARRAY),  m_array(makeShared<array>(values.get_allocator().resource(), values, values.get_allocator())) {}
+    Json::Json(array &&values)           : m_type(JsonType::ARRAY),  m_array(makeShared<array>(values.get_allocator().resource(), std::move(values))) {}
+    Json::Json(const object &values)     : m_type(JsonType::OBJECT), m_object(makeShared<object>(values.get_allocator().resource(), values, values.get_allocator())) {}
+    Json::Json(object &&values)          : m_type(JsonType::OBJECT), m_object(makeShared<object>(values.get_allocator().resource(), std::move(values))) {}
+
+    array::array(const std::vector<Json> & values) : std::pmr::vector<Json>(values.begin(), values.end()) {}
+    array::array(std::vector<Json> && values)
+        : std::pmr::vector<Json>(std::make_move_iterator(values.begin()), std::make_move_iterator(values.end())) {}
+
+    Json::Json(const Json & other) : m_type(other.m_type), m_numberType(other.m_numberType)
+    {
+        switch(m_type)
+        {
+            case JsonType::STRING: m_string = retain(other.m_string); break;
+            case JsonType::ARRAY:  m_array  = retain(other.m_array);  break;
+            case JsonType::OBJECT: m_object = retain(other.m_object); break;
+            case JsonType::NUMBER:
+                if(m_numberType == NumberType::RAW)
+                {
+                    m_string = retain(other.m_string);
+                    break;
+                }
+                [[fallthrough]];
+            default:               m_uint = other.m_uint;             break;
+        }
+    }
+    Json::Json(Json && other) noexcept : m_type(other.m_type), m_numberType(other.m_numberType), m_uint(other.m_uint)
+    {
+        other.m_type = JsonType::NUL; //避免被移动的对象重复释放
+    }
+    Json& Json::operator=(const Json& other) 
+    {
+        if (this != &other) // 防止自赋值
+        { 
+            Json copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+    Json& Json::operator=(Json&& other) noexcept 
+    {
+        if (this != &other) // 防止自赋值
+        { 
+            destroy();
+            m_type = other.m_type;
+            m_numberType = other.m_numberType;
+            m_uint = other.m_uint; // 按最大的成员整体拷贝
+            other.m_type = JsonType::NUL;
+        }
+        return *this;
+    }
+
+    void Json::destroy() noexcept
+    {
+        switch(m_type)
+        {
+            case JsonType::STRING: release(m_string); break;
+            case JsonType::ARRAY:  release(m_array);  break;
+            case JsonType::OBJECT: release(m_object); break;
+            case JsonType::NUMBER:
+                if(m_numberType == NumberType::RAW)
+                    release(m_string);
+                break;
+            default: break;
+        }
+        m_type = JsonType::NUL;
+    }
+    //constructor
+    //getValue
+    double Json::getNumber() const 
+    { 
+        if(m_type != JsonType::NUMBER) 
+            throwTypeError(__func__, m_type);
+        switch(m_numberType)
+        {
+            case NumberType::INT64:  return double(m_int);
+            case NumberType::UINT64: return double(m_uint);
+            case NumberType::RAW:    return rawToDouble(m_string->value);
+            default:                 return m_number;
+        }
+    }
+    int64_t Json::getInt64() const 
+    { 
+        if(m_type != JsonType::NUMBER) 
+            throwTypeError(__func__, m_type);
+        int64_t value = 0;
+        if(m_numberType == NumberType::INT64)
+            return m_int;
+        if(m_numberType != NumberType::UINT64 && doubleToInt64(getNumber(), value))
+            return value;
+        throwRangeError(__func__);
+    }
+    uint64_t Json::getUint64() const 
+    { 
+        if(m_type != JsonType::NUMBER) 
+            throwTypeError(__func__, m_type);
+        uint64_t value = 0;
+        if(m_numberType == NumberType::UINT64 || (m_numberType == NumberType::INT64 && m_int >= 0))
+            return m_uint;
+        if(m_numberType != NumberType::INT64 && doubleToUint64(getNumber(), value))
+            return value;
+        throwRangeError(__func__);
+    }
+    NumberType Json::numberType() const 
+    { 
+        if(m_type != JsonType::NUMBER) 
+            throwTypeError(__func__, m_type);
+        return m_numberType; 
+    }
+    std::string_view Json::getRawNumber() const 
+    { 
+        if(m_type != JsonType::NUMBER || m_numberType != NumberType::RAW) 
+            throwTypeError(__func__, m_type);
+        return m_string->value; 
+    }
+    bool Json::getBool() const 
+    { 
+        if(m_type != JsonType::BOOL) 
+            throwTypeError(__func__, m_type);
+        return m_bool; 
+    }
+    const std::string & Json::getString() const 
+    { 
+        if(m_type != JsonType::STRING) 
+            throwTypeError(__func__, m_type);
+        return m_string->value; 
+    }
+    const array & Json::getArray() const 
+    { 
+        if(m_type != JsonType::ARRAY) 
+            throwTypeError(__func__, m_type);
+        return m_array->value; 
+    }
+    const object & Json::getObject() const 
+    { 
+        if(m_type != JsonType::OBJECT) 
+            throwTypeError(__func__, m_type);
+        return m_object->value; 
+    }
+    //getValue
+    //setValue
+    void Json::setNumber(double value) 
+    { 
+        if(m_type != JsonType::NUMBER) 
+            throwTypeError(__func__, m_type);
+        *this = Json(value); 
+    }
+    void Json::setInt64(int64_t value) 
+    { 
+        if(m_type != JsonType::NUMBER) 
+            throwTypeError(__func__, m_type);
+        *this = Json((long long)value); 
+    }
+    void Json::setUint64(uint64_t value) 
+    { 
+        if(m_type != JsonType::NUMBER) 
+            throwTypeError(__func__, m_type);
+        *this = Json((unsigned long long)value); 
+    }
+    void Json::setBool(bool value) 
+    { 
+        if(m_type != JsonType::BOOL) 
+            throwTypeError(__func__, m_type);
+        m_bool = value; 
+    }
+    void Json::setString(const std::string & value) 
+    { 
+        if(m_type != JsonType::STRING) 
+            throwTypeError(__func__, m_type);
+        mutate(m_string) = value; 
+    }
+    void Json::setArray(const array & value) 
+    { 
+        if(m_type != JsonType::ARRAY) 
+            throwTypeError(__func__, m_type);
+        mutate(m_array) = value; 
+    }
+    void Json::setObject(const object & value) 
+    { 
+        if(m_type != JsonType::OBJECT) 
+            throwTypeError(__func__, m_type);
+        mutate(m_object) = value; 
+    }
+
+    void Json::addToArray (const Json & value) 
+    { 
+        if(m_type != JsonType::ARRAY) 
+            throwTypeError(__func__, m_type);
+        mutate(m_array).emplace_back(value);
+    }
+    void Json::addToObject(const std::string & key, const Json & value) 
+    { 
+        if(m_type != JsonType::OBJECT) 
+            throwTypeError(__func__, m_type);
+        mutate(m_object)[key] = value;
+    }
+    void Json::removeFromArray(size_t index) 
+    { 
+        if(m_type != JsonType::ARRAY) 
+            throwTypeError(__func__, m_type);
+        if (index < m_array->value.size()) 
+        {
+            array & values = mutate(m_array);
+            values.erase(values.begin() + index);
+        }
+        else
+        {
+            throw ghJsonException(std::string(__func__) + "index out of range!", 0);
+        }
+    }
+    void Json::removeFromObject(const std::string& key) 
+    { 
+        if(m_type != JsonType::OBJECT) 
+            throwTypeError(__func__, m_type);
+        if(m_object->value.find(key) == m_object->value.end())
+        {
+            throw ghJsonException(std::string(__func__) + " key :[" + key + "] not exits! ", 0);
+        }
+        else
+            mutate(m_object).erase(key);
+    }
+    //setValue
+    //operator[]
+    Json & Json::operator[](size_t i) 
+    { 
+        if(m_type != JsonType::ARRAY) 
+            throwTypeError(__func__, m_type);
+        if (i < m_array->value.size()) 
+        {
+            return mutate(m_array)[i];
+        }
+        else
+        {
+            throw ghJsonException(std::string(__func__) + "index out of range!", 0);
+        }
+    }
+    Json & Json::operator[](const std::string &key) 
+    { 
+        if(m_type != JsonType::OBJECT) 
+            throwTypeError(__func__, m_type);
+        return mutate(m_object)[key];
+    }
+    const Json & Json::operator[](size_t i) const 
+    { 
+        if(m_type != JsonType::ARRAY) 
+            throwTypeError(__func__, m_type);
+        if (i < m_array->value.size()) 
+        {
+            return m_array->value[i];
+        }
+        else
+        {
+            throw ghJsonException(std::string(__func__) + "index out of range!", 0);
+        }
+    }
+    const Json & Json::operator[](const std::string &key) const 
+    { 
+        if(m_type != JsonType::OBJECT) 
+            throwTypeError(__func__, m_type);
+        auto iter = m_object->value.find(key);
+        if(iter == m_object->value.end())
+        {
+            throw ghJsonException(std::string(__func__) + " key :[" + key + "] not exits! ", 0);
+        }
+        else
+            return iter->second;
+    }
+    //operator[]
+    //find
+    const Json * Json::find(size_t index) const noexcept
+    {
+        if(m_type != JsonType::ARRAY || index >= m_array->value.size())
+            return nullptr;
+        return &m_array->value[index];
+    }
+    const Json * Json::find(const std::string &key) const noexcept
+    {
+        if(m_type != JsonType::OBJECT)
+            return nullptr;
+        auto iter = m_object->value.find(key);
+        return iter == m_object->value.end() ? nullptr : &iter->second;
+    }
+    //find
+    //operator==
+    //==和<都不递归: 容器压栈后逐个比较子节点，和writeValue一样再深的嵌套也只占一层栈
+    //字典序比较里第一个不相同的子节点就决定了每一层的结果，所以遇到不同可以直接返回
+    class JsonCompare
+    {
+        public:
+            static bool equal(const Json & lhs, const Json & rhs)
+            {
+                std::vector<Frame> frames;
+                if(!openEqual(frames, lhs, rhs))
+                    return false;
+                while(!frames.empty())
+                {
+                    size_t depth = frames.size();
+                    Frame & top = frames.back();
+                    if(top.lhs->m_type == JsonType::ARRAY)
+                    {
+                        const array & a = top.lhs->m_array->value;
+                        const array & b = top.rhs->m_array->value;
+                        // 压栈后top可能失效，先比较深度
+                        while(frames.size() == depth && top.index < a.size())
+                        {
+                            size_t i = top.index++;
+                            if(!openEqual(frames, a[i], b[i]))
+                                return false;
+                        }
+                    }
+                    else
+                    {
+                        const object & a = top.lhs->m_object->value;
+                        while(frames.size() == depth && top.iter != a.end())
+                        {
+                            auto iter = top.iter++;
+#if GHJSON_OBJECT_BACKEND == GHJSON_OBJECT_MAP || GHJSON_OBJECT_BACKEND == GHJSON_OBJECT_FLAT
+                            auto other = top.other++;   // 都按key排序，逐个对应
+                            if(iter->first != other->first)
+                                return false;
+#else
+                            auto other = top.rhs->m_object->value.find(iter->first);    // 和迭代顺序无关
+                            if(other == top.rhs->m_object->value.end())
+                                return false;
+#endif
+                            if(!openEqual(frames, iter->second, other->second))
+                                return false;
+                        }
+                    }
+                    if(frames.size() == depth)
+                        frames.pop_back();
+                }
+                return true;
+            }
+
+            // -1/1: lhs小于/大于rhs，0: 互相都不小于
+            static int order(const Json & lhs, const Json & rhs)
+            {
+                std::vector<Frame> frames;
+                int result = openOrder(frames, lhs, rhs);
+                while(result == 0 && !frames.empty())
+                {
+                    size_t depth = frames.size();
+                    Frame & top = frames.back();
+                    size_t sizeA, sizeB;
+                    if(top.lhs->m_type == JsonType::ARRAY)
+                    {
+                        const array & a = top.lhs->m_array->value;
+                        const array & b = top.rhs->m_array->value;
+                        sizeA = a.size();
+                        sizeB = b.size();
+                        while(result == 0 && frames.size() == depth && top.index < std::min(sizeA, sizeB))
+                        {
+                            size_t i = top.index++;
+                            result = openOrder(frames, a[i], b[i]);
+                        }
+                    }
+                    else
+                    {
+                        sizeA = top.lhs->m_object->value.size();
+                        sizeB = top.rhs->m_object->value.size();
+                        while(result == 0 && frames.size() == depth && top.index < std::min(sizeA, sizeB))
+                        {
+#if GHJSON_OBJECT_BACKEND == GHJSON_OBJECT_MAP || GHJSON_OBJECT_BACKEND == GHJSON_OBJECT_FLAT
+                            const object::value_type & x = *top.iter++;
+                            const object::value_type & y = *top.other++;
+#else
+                            const object::value_type & x = *top.sortedA[top.index];
+                            const object::value_type & y = *top.sortedB[top.index];
+#endif
+                            top.index++;
+                            // 和std::pair一样先比较key
+                            int keys = x.first.compare(y.first);
+                            result = keys < 0 ? -1 : (keys > 0 ? 1 : openOrder(frames, x.second, y.second));
+                        }
+                    }
+                    if(result == 0 && frames.size() == depth)
+                    {
+                        if(sizeA != sizeB)
+                            return sizeA < sizeB ? -1 : 1;
+                        frames.pop_back();
+                    }
+                }
+                return result;
+            }
+        private:
+            struct Frame
+            {
+                const Json *           lhs;
+                const Json *           rhs;
+                size_t                 index;
+                object::const_iterator iter;    // 按key排序的后端: lhs和rhs当前的成员
+                object::const_iterator other;
+#if GHJSON_OBJECT_BACKEND != GHJSON_OBJECT_MAP && GHJSON_OBJECT_BACKEND != GHJSON_OBJECT_FLAT
+                std::vector<const object::value_type *> sortedA;   // 哈希后端比较大小时按key排序
+                std::vector<const object::value_type *> sortedB;
+#endif
+            };
+
+            static void push(std::vector<Frame> & frames, const Json & lhs, const Json & rhs)
+            {
+                frames.emplace_back();
+                Frame & frame = frames.back();
+                frame.lhs = &lhs;
+                frame.rhs = &rhs;
+                frame.index = 0;
+                if(lhs.m_type == JsonType::OBJECT)
+                {
+                    frame.iter = lhs.m_object->value.begin();
+                    frame.other = rhs.m_object->value.begin();
+                }
+            }
+
+            // 标量直接比较；大小相同的容器压栈，返回false表示已经不相等
+            static bool openEqual(std::vector<Frame> & frames, const Json & lhs, const Json & rhs)
+            {
+                if(&lhs == &rhs)
+                    return true;
+                if(lhs.m_type != rhs.m_type)
+                    return false;
+                switch(lhs.m_type)
+                {
+                    case JsonType::NUL:    return true;
+                    case JsonType::BOOL:   return lhs.m_bool == rhs.m_bool;
+                    case JsonType::NUMBER:
+                        if(lhs.m_numberType == rhs.m_numberType && lhs.m_numberType != NumberType::RAW)
+                            return lhs.m_numberType == NumberType::DOUBLE ? lhs.m_number == rhs.m_number : lhs.m_uint == rhs.m_uint;
+                        return compareNumber(lhs, rhs) == 0;
+                    case JsonType::STRING: return lhs.m_string == rhs.m_string || lhs.m_string->value == rhs.m_string->value;
+                    case JsonType::ARRAY:
+                        if(lhs.m_array == rhs.m_array)
+                            return true;
+                        if(lhs.m_array->value.size() != rhs.m_array->value.size())
+                            return false;
+                        break;
+                    case JsonType::OBJECT:
+                        if(lhs.m_object == rhs.m_object)
+                            return true;
+                        if(lhs.m_object->value.size() != rhs.m_object->value.size())
+                            return false;
+                        break;
+                }
+                push(frames, lhs, rhs);
+                return true;
+            }
+
+            static int sign(bool less, bool greater) { return less ? -1 : (greater ? 1 : 0); }
+
+            // 标量直接比较，容器压栈后返回0
+            static int openOrder(std::vector<Frame> & frames, const Json & lhs, const Json & rhs)
+            {
+                if(&lhs == &rhs)
+                    return 0;
+                if(lhs.m_type != rhs.m_type)
+                    return lhs.m_type < rhs.m_type ? -1 : 1;
+                switch(lhs.m_type)
+                {
+                    case JsonType::NUL:    return 0;
+                    case JsonType::BOOL:   return sign(lhs.m_bool < rhs.m_bool, rhs.m_bool < lhs.m_bool);
+                    case JsonType::NUMBER:
+                        if(lhs.m_numberType == rhs.m_numberType && lhs.m_numberType != NumberType::RAW)
+                        {
+                            switch(lhs.m_numberType)
+                            {
+                                case NumberType::INT64:  return sign(lhs.m_int < rhs.m_int, rhs.m_int < lhs.m_int);
+                                case NumberType::UINT64: return sign(lhs.m_uint < rhs.m_uint, rhs.m_uint < lhs.m_uint);
+                                default:                 return sign(lhs.m_number < rhs.m_number, rhs.m_number < lhs.m_number);
+                            }
+                        }
+                        else
+                        {
+                            int result = compareNumber(lhs, rhs);
+                            return result == 2 ? 0 : result;   // NaN和谁都不分大小
+                        }
+                    case JsonType::STRING:
+                    {
+                        if(lhs.m_string == rhs.m_string)
+                            return 0;
+                        int result = lhs.m_string->value.compare(rhs.m_string->value);
+                        return sign(result < 0, result > 0);
+                    }
+                    case JsonType::ARRAY:
+                        if(lhs.m_array == rhs.m_array)
+                            return 0;
+                        push(frames, lhs, rhs);
+                        return 0;
+                    case JsonType::OBJECT:
+                        if(lhs.m_object == rhs.m_object)
+                            return 0;
+                        push(frames, lhs, rhs);
+#if GHJSON_OBJECT_BACKEND != GHJSON_OBJECT_MAP && GHJSON_OBJECT_BACKEND != GHJSON_OBJECT_FLAT
+                        // 按key排序后逐个比较，迭代顺序不同也能得到和std::map一致的结果
+                        sortMembers(lhs.m_object->value, frames.back().sortedA);
+                        sortMembers(rhs.m_object->value, frames.back().sortedB);
+#endif
+                        return 0;
+                }
+                return 0;
+            }
+
+#if GHJSON_OBJECT_BACKEND != GHJSON_OBJECT_MAP && GHJSON_OBJECT_BACKEND != GHJSON_OBJECT_FLAT
+            static void sortMembers(const object & values, std::vector<const object::value_type *> & out)
+            {
+                out.reserve(values.size());
+                for(const auto & item : values)
+                    out.push_back(&item);
+                std::sort(out.begin(), out.end(), [](auto a, auto b) { return a->first < b->first; });
+            }
+#endif
+    };
+
+    bool Json::operator== (const Json &rhs) const
+    {
+        return JsonCompare::equal(*this, rhs);
+    }
+    bool Json::operator< (const Json &rhs) const
+    {
+        return JsonCompare::order(*this, rhs) < 0;
+    }
+    //operator==
+    //dump
+    // 找到下一个需要转义的字符: 引号、反斜杠和小于0x20的控制字符
+    inline const char * findEscape(const char * p, const char * end)
+    {
+#if defined(__SSE2__)
+        const __m128i quote = _mm_set1_epi8('\"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i control = _mm_set1_epi8(0x1F);
+        for( ; end - p >= 16; p += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            __m128i low = _mm_cmpeq_epi8(_mm_max_epu8(v, control), control);   // v <= 0x1F
+            int mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)), low));
+            if(mask)
+                return p + __builtin_ctz(mask);
+        }
+#endif
+        while(p != end && *p != '\"' && *p != '\\' && static_cast<unsigned char>(*p) >= 0x20)
+            p++;
+        return p;
+    }
+
+    //Writer
+    const uint8_t kInObject = 1;    // m_stack里每层的标志位
+    const uint8_t kHasItem  = 2;
+    const uint8_t kHasKey   = 4;    // 对象里写了键，还没有写值
+
+    Writer::Writer(Sink & sink, const DumpOptions & options, size_t bufferSize) 
+        : m_sink(&sink), m_out(nullptr), m_buffer(std::max<size_t>(bufferSize, 64)), m_done(false), m_options(options)
+    {
+        m_cur = m_buffer.data();
+        m_end = m_buffer.data() + m_buffer.size();
+    }
+
+    Writer::Writer(std::string & out, const DumpOptions & options) : m_sink(nullptr), m_out(&out), m_done(false), m_options(options)
+    {
+        size_t used = out.size();
+        out.resize(used + 256);
+        m_cur = &out[0] + used;
+        m_end = &out[0] + out.size();
+    }
+
+    Writer::~Writer()
+    {
+        try
+        {
+            flush();
+        }
+        catch(...)
+        {
+            // 析构时的写错误只能丢掉，需要知道结果请先调用flush()
+        }
+    }
+
+    void Writer::flush()
+    {
+        if(m_sink)
+        {
+            if(m_cur != m_buffer.data())
+                m_sink->write(m_buffer.data(), m_cur - m_buffer.data());
+            m_cur = m_buffer.data();
+            return;
+        }
+        size_t used = m_cur - &(*m_out)[0];
+        m_out->resize(used);
+        m_cur = m_end = &(*m_out)[0] + used;
+    }
+
+    // 写到Sink时把缓冲交出去；写到string时按需要的最大长度扩容，后面直接通过指针写
+    void Writer::grow(size_t n)
+    {
+        if(m_sink)
+        {
+            m_sink->write(m_buffer.data(), m_cur - m_buffer.data());
+            m_cur = m_buffer.data();
+            return;
+        }
+        size_t used = m_cur - &(*m_out)[0];
+        m_out->resize(std::max(m_out->size() * 2, used + n + 256));
+        m_cur = &(*m_out)[0] + used;
+        m_end = &(*m_out)[0] + m_out->size();
+    }
+
+    // 比缓冲还长的内容分几次写
+    void Writer::put(const char * data, size_t size)
+    {
+        while(size_t(m_end - m_cur) < size)
+        {
+            size_t room = m_end - m_cur;
+            memcpy(m_cur, data, room);
+            m_cur += room;
+            data += room;
+            size -= room;
+            grow(size);
+        }
+        memcpy(m_cur, data, size);
+        m_cur += size;
+    }
+
+    // pretty: 换行并缩进到第level层
+    void Writer::newline(size_t level)
+    {
+        static const char spaces[] = "                                                                ";
+        ensure(1);
+        put('\n');
+        for(size_t n = level * m_options.indent; n > 0; )
+        {
+            size_t step = std::min(n, sizeof(spaces) - 1);
+            put(spaces, step);
+            n -= step;
+        }
+    }
+
+    void Writer::beforeValue()
+    {
+        if(m_stack.empty())
+        {
+            if(m_done)
+                throw ghJsonException("Writer: more than one top-level value", 0);
+            m_done = true;  // 顶层容器也算，闭合前里面的值都在栈里
+            return;
+        }
+        uint8_t & top = m_stack.back();
+        if(top & kInObject)
+        {
+            if(!(top & kHasKey))
+                throw ghJsonException("Writer: value in an object without a key", 0);
+            top &= ~kHasKey;
+            return;     // 对象里的值紧跟在键后面
+        }
+        if(top & kHasItem)
+        {
+            ensure(1);
+            put(',');
+        }
+        if(m_options.pretty)
+            newline(m_stack.size());
+        top |= kHasItem;
+    }
+
+    void Writer::writeNumber(double value)
+    {
+        ensure(32);
+        // JSON里没有inf和nan
+        if(!std::isfinite(value))
+        {
+            put("null", 4);
+            return;
+        }
+        // 整数快速路径；-0保留符号走通用路径
+        if(value >= -1e15 && value <= 1e15 && value == double(int64_t(value)) && !(value == 0 && std::signbit(value)))
+            m_cur = std::to_chars(m_cur, m_end, int64_t(value)).ptr;
+        else
+            m_cur = std::to_chars(m_cur, m_end, value).ptr;
+    }
+
+    void Writer::writeString(std::string_view str)
+    {
+        ensure(1);
+        put('\"');
+        const char * p = str.data();
+        const char * end = p + str.size();
+        while(1)
+        {
+            const char * q = findEscape(p, end);
+            put(p, q - p);
+            if(q == end)
+                break;
+            ensure(6);
+            put('\\');
+            switch(*q)
+            {
+                case '\"':  put('\"'); break;
+                case '\\': put('\\'); break;
+                case '\b': put('b'); break;
+                case '\f': put('f'); break;
+                case '\n': put('n'); break;
+                case '\r': put('r'); break;
+                case '\t': put('t'); break;
+                default:
+                {
+                    static const char hex[] = "0123456789abcdef";
+                    unsigned char c = static_cast<unsigned char>(*q);
+                    put("u00", 3);
+                    put(hex[c >> 4]);
+                    put(hex[c & 0xF]);
+                }
+            }
+            p = q + 1;
+        }
+        ensure(1);
+        put('\"');
+    }
+
+    bool Writer::on_null()
+    {
+        beforeValue();
+        put("null", 4);
+        return true;
+    }
+
+    bool Writer::on_bool(bool value)
+    {
+        beforeValue();
+        value ? put("true", 4) : put("false", 5);
+        return true;
+    }
+
+    bool Writer::on_number(double value)
+    {
+        beforeValue();
+        writeNumber(value);
+        return true;
+    }
+
+    // 整数直接按整数格式化，不经过double
+    bool Writer::on_int64(int64_t value)
+    {
+        beforeValue();
+        ensure(24);
+        m_cur = std::to_chars(m_cur, m_end, value).ptr;
+        return true;
+    }
+
+    bool Writer::on_uint64(uint64_t value)
+    {
+        beforeValue();
+        ensure(24);
+        m_cur = std::to_chars(m_cur, m_end, value).ptr;
+        return true;
+    }
+
+    bool Writer::on_raw_number(std::string_view text)
+    {
+        beforeValue();
+        put(text.data(), text.size());
+        return true;
+    }
+
+    bool Writer::on_string(std::string_view value)
+    {
+        beforeValue();
+        writeString(value);
+        return true;
+    }
+
+    bool Writer::on_key(std::string_view key)
+    {
+        if(m_stack.empty() || !(m_stack.back() & kInObject))
+            throw ghJsonException("Writer: key outside of an object", 0);
+        if(m_stack.back() & kHasKey)
+            throw ghJsonException("Writer: key without a value", 0);
+        if(m_stack.back() & kHasItem)
+        {
+            ensure(1);
+            put(',');
+        }
+        if(m_options.pretty)
+            newline(m_stack.size());
+        m_stack.back() |= kHasItem | kHasKey;
+        writeString(key);
+        m_options.pretty ? put(": ", 2) : put(":", 1);
+        return true;
+    }
+
+    bool Writer::start_object()
+    {
+        beforeValue();
+        ensure(1);
+        put('{');
+        m_stack.push_back(kInObject);
+        return true;
+    }
+
+    bool Writer::end_object()
+    {
+        if(m_stack.empty() || !(m_stack.back() & kInObject))
+            throw ghJsonException("Writer: end_object without a matching start_object", 0);
+        if(m_stack.back() & kHasKey)
+            throw ghJsonException("Writer: key without a value", 0);
+        bool empty = !(m_stack.back() & kHasItem);
+        m_stack.pop_back();
+        if(m_options.pretty && !empty)
+            newline(m_stack.size());
+        ensure(1);
+        put('}');
+        return true;
+    }
+
+    bool Writer::start_array()
+    {
+        beforeValue();
+        ensure(1);
+        put('[');
+        m_stack.push_back(0);
+        return true;
+    }
+
+    bool Writer::end_array()
+    {
+        if(m_stack.empty() || (m_stack.back() & kInObject))
+            throw ghJsonException("Writer: end_array without a matching start_array", 0);
+        bool empty = !(m_stack.back() & kHasItem);
+        m_stack.pop_back();
+        if(m_options.pretty && !empty)
+            newline(m_stack.size());
+        ensure(1);
+        put(']');
+        return true;
+    }
+
+    // 带类名调用，避免走虚函数
+    // 用显式栈遍历，深层嵌套也不会爆栈；标量子节点在容器的循环里直接写出
+    void Writer::writeValue(const Json & root)
+    {
+        struct Frame
+        {
+            const array *          items;      // 数组时非空
+            size_t                 index;
+            const object *         members;    // 对象时非空
+            object::const_iterator iter;
+        };
+        std::vector<Frame> frames;
+        // 标量直接写出返回false，容器写开头并压栈返回true
+        auto open = [&](const Json & json)
+        {
+            switch(json.type())
+            {
+                case JsonType::NUL:    Writer::on_null(); break;
+                case JsonType::BOOL:   Writer::on_bool(json.getBool()); break;
+                case JsonType::NUMBER:
+                    switch(json.numberType())
+                    {
+                        case NumberType::INT64:  Writer::on_int64(json.getInt64()); break;
+                        case NumberType::UINT64: Writer::on_uint64(json.getUint64()); break;
+                        case NumberType::RAW:    Writer::on_raw_number(json.getRawNumber()); break;
+                        default:                 Writer::on_number(json.getNumber()); break;
+                    }
+                    break;
+                case JsonType::STRING: Writer::on_string(json.getString()); break;
+                case JsonType::ARRAY:
+                    Writer::start_array();
+                    frames.push_back(Frame{&json.getArray(), 0, nullptr, object::const_iterator()});
+                    return true;
+                case JsonType::OBJECT:
+                    Writer::start_object();
+                    frames.push_back(Frame{nullptr, 0, &json.getObject(), json.getObject().begin()});
+                    return true;
+            }
+            return false;
+        };
+        open(root);
+        while(!frames.empty())
+        {
+            Frame & top = frames.back();
+            bool pushed = false;
+            if(top.items)
+            {
+                const array & items = *top.items;
+                while(!pushed && top.index < items.size())
+                    pushed = open(items[top.index++]);  // 压栈后top可能失效，马上退出
+                if(!pushed)
+                    Writer::end_array();
+            }
+            else
+            {
+                const object & members = *top.members;
+                while(!pushed && top.iter != members.end())
+                {
+                    auto iter = top.iter++;
+                    Writer::on_key(iter->first);
+                    pushed = open(iter->second);
+                }
+                if(!pushed)
+                    Writer::end_object();
+            }
+            if(!pushed)
+                frames.pop_back();
+        }
+    }
+
+    void Writer::write(const Json & json)
+    {
+        writeValue(json);
+    }
+    //Writer
+    //Sink
+    void FdSink::write(const char * data, size_t size)
+    {
+#ifdef GHJSON_POSIX_FILE
+        while(size > 0)
+        {
+            ssize_t n = ::write(m_fd, data, size);
+            if(n < 0)
+            {
+                if(errno == EINTR)
+                    continue;
+                throw ghJsonException(std::string("FdSink: write failed: ") + strerror(errno), 0);
+            }
+            data += n;
+            size -= size_t(n);
+        }
+#else
+        (void)data;
+        (void)size;
+        throw ghJsonException("FdSink: file descriptors are not supported on this platform", 0);
+#endif
+    }
+
+    void FileSink::write(const char * data, size_t size)
+    {
+        if(std::fwrite(data, 1, size, m_file) != size)
+            throw ghJsonException("FileSink: fwrite failed", 0);
+    }
+
+    void StreamSink::write(const char * data, size_t size)
+    {
+        if(!m_os.write(data, std::streamsize(size)))
+            throw ghJsonException("StreamSink: stream write failed", 0);
+    }
+    //Sink
+
+    const std::string Json::dump(const DumpOptions & options) const
+    {
+        std::string str;
+        dump(str, options);
+        return str;
+    }
+    void Json::dump(std::string &out, const DumpOptions & options) const 
+    { 
+        Writer writer(out, options);
+        writer.write(*this);
+    }
+
+    void Json::dumpTo(Sink & sink, const DumpOptions & options) const
+    {
+        Writer writer(sink, options);
+        writer.write(*this);
+        writer.flush();
+    }
+    void Json::dumpTo(int fd, const DumpOptions & options) const
+    {
+        FdSink sink(fd);
+        dumpTo(sink, options);
+    }
+    void Json::dumpTo(std::FILE * file, const DumpOptions & options) const
+    {
+        FileSink sink(file);
+        dumpTo(sink, options);
+    }
+    void Json::dumpTo(std::ostream & os, const DumpOptions & options) const
+    {
+        StreamSink sink(os);
+        dumpTo(sink, options);
+    }
+    //dump
+    //iterator
+    arrayiter Json::arrayBegin() 
+    { 
+        if(m_type != JsonType::ARRAY) 
+            throwTypeError(__func__, m_type);
+        return mutate(m_array).begin(); 
+    }
+    const_arrayiter Json::arrayBegin_const() const 
+    { 
+        if(m_type != JsonType::ARRAY) 
+            throwTypeError(__func__, m_type);
+        return m_array->value.cbegin();
+    }
+    arrayiter Json::arrayEnd() 
+    { 
+        if(m_type != JsonType::ARRAY) 
+            throwTypeError(__func__, m_type);
+        return mutate(m_array).end(); 
+    }
+    const_arrayiter Json::arrayEnd_const() const 
+    { 
+        if(m_type != JsonType::ARRAY) 
+            throwTypeError(__func__, m_type);
+        return m_array->value.cend();
+    }    
+    objectiter Json::objectBegin()
+    { 
+        if(m_type != JsonType::OBJECT) 
+            throwTypeError(__func__, m_type);
+        return mutate(m_object).begin();
+    }
+    const_objectiter Json::objectBegin_const() const 
+    { 
+        if(m_type != JsonType::OBJECT) 
+            throwTypeError(__func__, m_type);
+        return m_object->value.cbegin();
+    }
+    objectiter Json::objectEnd()
+    { 
+        if(m_type != JsonType::OBJECT) 
+            throwTypeError(__func__, m_type);
+        return mutate(m_object).end();
+    }
+    const_objectiter Json::objectEnd_const() const 
+    { 
+        if(m_type != JsonType::OBJECT) 
+            throwTypeError(__func__, m_type);
+        return m_object->value.cend();
+    }
+    //iterator
+    //Json
+    //parse
+    void checkIndex(std::string_view str, size_t idx) 
+    {
+        if (idx >= str.size()) 
+        {
+            throw ghJsonException("Unexpected end", idx);
+        }
+    }
+
+    void parseWhitespace(std::string_view str, size_t & idx)
+    {
+        while (idx < str.size() && (str[idx] == ' ' || str[idx] == '\r' || str[idx] == '\n' || str[idx] == '\t'))
+            idx++;
+    }
+
+    // 找到下一个a或b，每次比较16字节
+    inline const char * findEither(const char * p, const char * end, char a, char b)
+    {
+#if defined(__SSE2__)
+        const __m128i va = _mm_set1_epi8(a);
+        const __m128i vb = _mm_set1_epi8(b);
+        for( ; end - p >= 16; p += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+            if(mask)
+                return p + __builtin_ctz(mask);
+        }
+#endif
+        while(p != end && *p != a && *p != b)
+            p++;
+        return p;
+    }
+
+    // 找到下一个引号或反斜杠，它们之间的字符可以整段拷贝
+    inline const char * findQuoteOrBackslash(const char * p, const char * end)
+    {
+        return findEither(p, end, '\"', '\\');
+    }
+
+    // p指向4位十六进制数字
+    ParseErrc readHex4(const char * p, const char * end, unsigned & value)
+    {
+        if(end - p < 4)
+            return ParseErrc::UNEXPECTED_END;
+        value = 0;
+        for(int i = 0; i < 4; i++)
+        {
+            char c = p[i];
+            value <<= 4;
+            if(c >= '0' && c <= '9')      value |= c - '0';
+            else if(c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+            else if(c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+            else return ParseErrc::INVALID_UNICODE;
+        }
+        return ParseErrc::NONE;
+    }
+
+    void encodeUtf8(unsigned code, std::string & out)
+    {
+        if(code < 0x80)
+        {
+            out += char(code);
+        }
+        else if(code < 0x800)
+        {
+            out += char(0xC0 | (code >> 6));
+            out += char(0x80 | (code & 0x3F));
+        }
+        else if(code < 0x10000)
+        {
+            out += char(0xE0 | (code >> 12));
+            out += char(0x80 | ((code >> 6) & 0x3F));
+            out += char(0x80 | (code & 0x3F));
+        }
+        else
+        {
+            out += char(0xF0 | (code >> 18));
+            out += char(0x80 | ((code >> 12) & 0x3F));
+            out += char(0x80 | ((code >> 6) & 0x3F));
+            out += char(0x80 | (code & 0x3F));
+        }
+    }
+
+    // 单字符转义对应的字符，0表示不是单字符转义
+    const char kSimpleEscape[256] =
+    {
+        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+        0,0,'"',0,0,0,0,0,0,0,0,0,0,0,0,'/', 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,'\\',0,0,0,
+        0,0,'\b',0,0,0,'\f',0,0,0,0,0,0,0,'\n',0, 0,0,'\r',0,'\t',0,0,0,0,0,0,0,0,0,0,0,
+    };
+
+    // p指向反斜杠，成功时p移到转义序列之后，出错时p指向出错位置
+    ParseErrc readEscape(const char *& p, const char * end, std::string & out)
+    {
+        p++;
+        if(p == end)
+            return ParseErrc::UNEXPECTED_END;
+        switch(*p)
+        {
+            case '\"':  out+='\"'; break;
+            case '\\':  out+='\\'; break;
+            case '/' :  out+='/' ; break;
+            case 'b' :  out+='\b'; break;
+            case 'f' :  out+='\f'; break;
+            case 'n' :  out+='\n'; break;
+            case 'r' :  out+='\r'; break;
+            case 't' :  out+='\t'; break;
+            case 'u' :
+            {
+                unsigned code = 0;
+                ParseErrc error = readHex4(p + 1, end, code);
+                if(error != ParseErrc::NONE)
+                    return error;
+                p += 4;
+                if(code >= 0xD800 && code <= 0xDBFF)
+                {
+                    // 高代理项后面必须紧跟一个 \uDC00-\uDFFF
+                    if(end - p < 3 || p[1] != '\\' || p[2] != 'u')
+                        return ParseErrc::INVALID_SURROGATE;
+                    unsigned low = 0;
+                    error = readHex4(p + 3, end, low);
+                    if(error != ParseErrc::NONE)
+                        return error;
+                    if(low < 0xDC00 || low > 0xDFFF)
+                        return ParseErrc::INVALID_SURROGATE;
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    p += 6;
+                }
+                else if(code >= 0xDC00 && code <= 0xDFFF)
+                {
+                    return ParseErrc::INVALID_SURROGATE;
+                }
+                encodeUtf8(code, out);
+                break;
+            }
+            default : return ParseErrc::INVALID_ESCAPE;
+        }
+        p++;
+        return ParseErrc::NONE;
+    }
+
+    // 解析字符串并追加到out，idx指向开头的引号；出错时idx指向出错位置
+    // 没有转义的部分整段追加，遇到反斜杠才逐个处理
+    ParseErrc readString(std::string_view str, size_t & idx, std::string & out) 
+    {
+        const char * begin = str.data();
+        const char * end = begin + str.size();
+        const char * p = begin + idx + 1;
+        while(1)
+        {
+            const char * q = findQuoteOrBackslash(p, end);
+            if(q == end)
+            {
+                idx = str.size();
+                return ParseErrc::UNEXPECTED_END;
+            }
+            if(*q == '\"')
+            {
+                out.append(p, q - p);
+                idx = q - begin + 1;
+                return ParseErrc::NONE;
+            }
+            // 有转义时结果不会比已扫过的原文长，按此预留空间，避免逐字符扩容
+            if(out.capacity() - out.size() < size_t(q - p) + 16)
+                out.reserve(out.size() + (q - p) + 16 + out.size() / 2);
+            out.append(p, q - p);
+            // 单字符转义直接查表，\u 交给readEscape
+            char c = q + 1 != end ? kSimpleEscape[static_cast<unsigned char>(q[1])] : 0;
+            if(c)
+            {
+                out += c;
+                p = q + 2;
+            }
+            else
+            {
+                p = q;
+                ParseErrc error = readEscape(p, end, out);
+                if(error != ParseErrc::NONE)
+                {
+                    idx = p - begin;
+                    return error;
+                }
+            }
+        }
+    }
+
+    // 不含转义时直接返回输入里的那一段，否则解码到buffer里
+    ParseErrc readStringView(std::string_view str, size_t & idx, std::string & buffer, std::string_view & out)
+    {
+        const char * begin = str.data() + idx + 1;
+        const char * end = str.data() + str.size();
+        const char * q = findQuoteOrBackslash(begin, end);
+        if(q != end && *q == '\"')
+        {
+            idx = q - str.data() + 1;
+            out = std::string_view(begin, q - begin);
+            return ParseErrc::NONE;
+        }
+        buffer.clear();
+        ParseErrc error = readString(str, idx, buffer);
+        out = buffer;
+        return error;
+    }
+
+    // 出错位置上的错误码拼回原来的异常信息，只在真正抛异常时才构造字符串
+    std::string errorMessage(ParseErrc code, std::string_view str, size_t pos)
+    {
+        switch(code)
+        {
+            case ParseErrc::UNEXPECTED_END:      return "Unexpected end";
+            case ParseErrc::INVALID_NUMBER:      return "Invalid number format";
+            case ParseErrc::NUMBER_OUT_OF_RANGE: return "Number out of range";
+            case ParseErrc::INVALID_UNICODE:     return "invalid unicode escape";
+            case ParseErrc::INVALID_SURROGATE:   return "invalid unicode surrogate";
+            case ParseErrc::INVALID_ESCAPE:      return "unknow sequence:" + std::string(str.substr(pos - 1, 2));
+            case ParseErrc::INVALID_LITERAL:
+            {
+                std::string_view literal = str[pos] == 'n' ? "null" : str[pos] == 't' ? "true" : "false";
+                return "[ERROR]:expected (" + std::string(literal) + "), got (" + std::string(str.substr(pos, literal.length())) + ")";
+            }
+            case ParseErrc::EXPECTED_KEY:          return "[ERROR]: object parsing, expect key";
+            case ParseErrc::EXPECTED_COLON:        return "[ERROR]: object parsing, expect':', got " + std::string(1, str[pos]);
+            case ParseErrc::EXPECTED_ARRAY_COMMA:  return "[ERROR]: array format worng, ";
+            case ParseErrc::EXPECTED_OBJECT_COMMA: return "[ERROR]: object format worng, ";
+            case ParseErrc::UNEXPECTED_CHARACTER:
+                // 结构字符出现在值的位置上，或者标量后面跟了别的字符
+                if(std::string_view("}]:,").find(str[pos]) != std::string_view::npos)
+                    return "[ERROR]: unexpected character";
+                return "[ERROR]: unexpected character after value";
+            case ParseErrc::DEPTH_EXCEEDED:        return "exceeded maximum nesting depth";
+            default:                               return ToString(code);
+        }
+    }
+
+    // 深度超限的异常位置沿用原来的0
+    [[noreturn]] void throwParseError(ParseErrc code, std::string_view str, size_t pos)
+    {
+        throw ghJsonException(errorMessage(code, str, pos), code == ParseErrc::DEPTH_EXCEEDED ? 0 : pos);
+    }
+
+    void parseStringTo(std::string_view str, size_t & idx, std::string & out) 
+    {
+        size_t pos = idx;
+        ParseErrc error = readString(str, pos, out);
+        if(error != ParseErrc::NONE)
+            throwParseError(error, str, pos);
+        idx = pos;
+    }
+
+    std::string_view parseStringView(std::string_view str, size_t & idx, std::string & buffer)
+    {
+        size_t pos = idx;
+        std::string_view out;
+        ParseErrc error = readStringView(str, pos, buffer, out);
+        if(error != ParseErrc::NONE)
+            throwParseError(error, str, pos);
+        idx = pos;
+        return out;
+    }
+
+    inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+    // 10^0 ~ 10^22 都能被double精确表示
+    const double kExactPow10[] =
+    {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    // 扫描出的数字: 能放进int64/uint64的整数不经过double；RAW只记类型，原文就是扫过的那一段
+    struct NumberToken
+    {
+        NumberType type;
+        union
+        {
+            double   d;
+            int64_t  i;
+            uint64_t u;
+        };
+    };
+
+    // 直接在输入上按JSON语法扫描数字: -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+    // 没有小数点和指数的整数直接得到int64/uint64；其余有效数字不超过19位且指数较小时走快速路径，否则交给std::from_chars
+    // raw为true时不能表示成整数的数字不转换，结果是RAW
+    // 成功时next指向数字之后，出错时指向出错位置
+    ParseErrc readNumber(const char * begin, const char * end, NumberToken & out, const char *& next, bool raw = false)
+    {
+        const char * p = begin;
+        bool negative = false;
+        if(p != end && *p == '-')
+        {
+            negative = true;
+            p++;
+        }
+        if(p == end || !isDigit(*p))
+        {
+            next = p;
+            return ParseErrc::INVALID_NUMBER;
+        }
+
+        uint64_t mantissa = 0;
+        int digits = 0;         // 已计入mantissa的有效数字个数
+        int64_t exponent = 0;   // 十进制指数修正
+        bool truncated = false; // 有效数字超过19位
+
+        if(*p == '0')
+        {
+            p++;
+        }
+        else
+        {
+            for( ; p != end && isDigit(*p); p++)
+            {
+                if(digits < 19)
+                {
+                    mantissa = mantissa * 10 + (*p - '0');
+                    digits++;
+                }
+                else
+                {
+                    truncated = true;
+                    exponent++;
+                }
+            }
+        }
+        bool integer = true;
+        if(p != end && *p == '.')
+        {
+            integer = false;
+            p++;
+            if(p == end || !isDigit(*p))
+            {
+                next = p;
+                return ParseErrc::INVALID_NUMBER;
+            }
+            for( ; p != end && isDigit(*p); p++)
+            {
+                if(digits < 19)
+                {
+                    mantissa = mantissa * 10 + (*p - '0');
+                    if(mantissa != 0)
+                        digits++;
+                    exponent--;
+                }
+                else
+                {
+                    truncated = true;
+                }
+            }
+        }
+        if(p != end && (*p == 'e' || *p == 'E'))
+        {
+            integer = false;
+            p++;
+            bool negExp = false;
+            if(p != end && (*p == '+' || *p == '-'))
+            {
+                negExp = (*p == '-');
+                p++;
+            }
+            if(p == end || !isDigit(*p))
+            {
+                next = p;
+                return ParseErrc::INVALID_NUMBER;
+            }
+            int64_t exp = 0;
+            for( ; p != end && isDigit(*p); p++)
+            {
+                if(exp < 100000)
+                    exp = exp * 10 + (*p - '0');
+            }
+            exponent += negExp ? -exp : exp;
+        }
+        next = p;
+
+        if(integer && (!truncated || exponent == 1))
+        {
+            // 20位的整数也可能放得进uint64；-0和小于INT64_MIN的整数仍按double处理
+            uint64_t value = mantissa;
+            bool fits = true;
+            if(truncated)
+            {
+                unsigned last = p[-1] - '0';
+                fits = mantissa <= (UINT64_MAX - last) / 10;
+                value = mantissa * 10 + last;
+            }
+            const uint64_t kMinInt64Magnitude = uint64_t(1) << 63;
+            if(fits && !negative)
+            {
+                out.type = value > uint64_t(INT64_MAX) ? NumberType::UINT64 : NumberType::INT64;
+                out.u = value;
+                return ParseErrc::NONE;
+            }
+            if(fits && value != 0 && value <= kMinInt64Magnitude)
+            {
+                out.type = NumberType::INT64;
+                out.i = value == kMinInt64Magnitude ? INT64_MIN : -int64_t(value);
+                return ParseErrc::NONE;
+            }
+        }
+        if(raw)
+        {
+            // 接受的输入和不保留原文时一样: 超出double范围的仍然报错；数量级不超过308的不用转换就知道在范围内
+            double check;
+            if(digits + exponent > 308 && std::from_chars(begin, p, check).ec == std::errc::result_out_of_range)
+            {
+                next = begin;
+                return ParseErrc::NUMBER_OUT_OF_RANGE;
+            }
+            out.type = NumberType::RAW;
+            return ParseErrc::NONE;
+        }
+
+        out.type = NumberType::DOUBLE;
+        double & value = out.d;
+        const uint64_t kMaxExactInt = uint64_t(1) << 53;
+        if(!truncated && mantissa <= kMaxExactInt)
+        {
+            value = double(mantissa);
+            bool exact = true;
+            if(exponent > 0 && exponent <= 22)
+                value *= kExactPow10[exponent];
+            else if(exponent < 0 && exponent >= -22)
+                value /= kExactPow10[-exponent];
+            else if(!integer && exponent != 0)
+                exact = false;
+            if(exact)
+            {
+                value = negative ? -value : value;
+                return ParseErrc::NONE;
+            }
+        }
+
+        // 慢速路径: std::from_chars直接在输入上转换，结果精确、不受locale影响，也不用拷贝
+        // 上溢和下溢都报result_out_of_range: 数量级不小于1的是上溢，下溢和strtod一样得到0
+        if(std::from_chars(begin, p, value).ec == std::errc::result_out_of_range)
+        {
+            if(digits + exponent > 0)
+            {
+                next = begin;
+                return ParseErrc::NUMBER_OUT_OF_RANGE;
+            }
+            value = negative ? -0.0 : 0.0;
+        }
+        return ParseErrc::NONE;
+    }
+
+    // RAW数字的原文已经校验过(包括范围)，按普通数字再读一遍
+    double rawToDouble(std::string_view text)
+    {
+        NumberToken value;
+        const char * next = text.data();
+        readNumber(text.data(), text.data() + text.size(), value, next);
+        switch(value.type)
+        {
+            case NumberType::INT64:  return double(value.i);
+            case NumberType::UINT64: return double(value.u);
+            default:                 return value.d;
+        }
+    }
+
+    NumberToken scanNumber(const char * begin, const char * end, size_t pos, const char *& next)
+    {
+        NumberToken value;
+        ParseErrc error = readNumber(begin, end, value, next);
+        if(error != ParseErrc::NONE)
+            throw ghJsonException(errorMessage(error, std::string_view(), 0), pos + (next - begin));
+        return value;
+    }
+
+    // 按存储方式分发数字事件，text是数字的原文
+    template<typename H>
+    bool emitNumber(H & handler, const NumberToken & value, std::string_view text)
+    {
+        switch(value.type)
+        {
+            case NumberType::INT64:  return handler.on_int64(value.i);
+            case NumberType::UINT64: return handler.on_uint64(value.u);
+            case NumberType::RAW:    return handler.on_raw_number(text);
+            default:                 return handler.on_number(value.d);
+        }
+    }
+
+    Json numberToJson(const NumberToken & value)
+    {
+        switch(value.type)
+        {
+            case NumberType::INT64:  return Json((long long)value.i);
+            case NumberType::UINT64: return Json((unsigned long long)value.u);
+            default:                 return Json(value.d);
+        }
+    }
+
+    Json parseNumber(std::string_view str, size_t &idx)
+    {
+        const char * begin = str.data() + idx;
+        const char * next = begin;
+        NumberToken value = scanNumber(begin, str.data() + str.size(), idx, next);
+        idx += next - begin;
+        return numberToJson(value);
+    }
+
+    Json Json::rawNumber(std::string_view text, std::pmr::memory_resource * resource)
+    {
+        NumberToken value;
+        const char * next = text.data();
+        ParseErrc error = readNumber(text.data(), text.data() + text.size(), value, next, true);
+        if(error == ParseErrc::NONE && next != text.data() + text.size())
+            error = ParseErrc::INVALID_NUMBER;
+        if(error != ParseErrc::NONE)
+            throw ghJsonException(errorMessage(error, std::string_view(), 0), next - text.data());
+        Json out;
+        out.m_type = JsonType::NUMBER;
+        out.m_numberType = NumberType::RAW;
+        out.m_string = makeShared<std::string>(resourceOr(resource), text);
+        return out;
+    }
+
+    bool readLiteral(std::string_view literal, std::string_view str, size_t & idx) 
+    {
+        if(str.compare(idx, literal.length(), literal) != 0)
+            return false;
+        idx += literal.length();
+        return true;
+    }
+
+    void matchLiteral(std::string_view literal, std::string_view str, size_t & idx) 
+    {
+        if(!readLiteral(literal, str, idx))
+            throwParseError(ParseErrc::INVALID_LITERAL, str, idx);
+    }
+
+    //SAX
+    //唯一的递归下降语法分析，按文档顺序把事件交给H
+    //H可以是对外的Handler(虚函数)，也可以是下面建树用的类(直接内联)
+    template<typename H>
+    class Reader
+    {
+        private:
+            std::string_view m_str;
+            size_t m_idx;
+            H & m_handler;
+            size_t m_maxDepth;
+            std::string m_buffer;   // 带转义的字符串解码到这里
+            std::string m_stack;    // 未闭合的 [ 和 {
+            bool m_inside;          // 正在解析最内层容器的成员
+            bool m_rawNumbers;
+            ParseErrc m_error;
+            size_t m_errorPos;
+        public:
+            Reader(std::string_view str, H & handler, size_t idx = 0, size_t maxDepth = ParseOptions().max_depth, bool rawNumbers = false) 
+                : m_str(str), m_idx(idx), m_handler(handler), m_maxDepth(maxDepth), m_inside(false), m_rawNumbers(rawNumbers), m_error(ParseErrc::NONE), m_errorPos(0) {}
+            size_t position() const { return m_idx; }
+            // 换一个输入从头开始，缓冲的容量留着(Parser复用)
+            void reset(std::string_view str) { m_str = str; m_idx = 0; }
+            void shrink() { std::string().swap(m_buffer); std::string().swap(m_stack); }
+            size_t capacity() const { return m_buffer.capacity() + m_stack.capacity(); }
+
+            // 出错时抛出ghJsonException；Handler返回false时返回false
+            bool parseValue(size_t depth)
+            {
+                if(read(depth))
+                    return true;
+                if(m_error != ParseErrc::NONE)
+                    throwError();
+                return false;
+            }
+
+            // 不抛异常的版本: 出错时返回false，error()和errorPosition()给出错误码和位置
+            // 用显式栈代替递归，嵌套层数只受m_maxDepth限制
+            bool read(size_t depth)
+            {
+                m_stack.clear();
+                m_inside = false;
+                m_error = ParseErrc::NONE;
+                while(1)
+                {
+                    if(depth + m_stack.size() > m_maxDepth)
+                        return fail(ParseErrc::DEPTH_EXCEEDED, m_idx);
+                    parseWhitespace(m_str, m_idx);
+                    if(m_idx >= m_str.size())
+                        return fail(ParseErrc::UNEXPECTED_END, m_idx);
+
+                    switch(m_str[m_idx])
+                    {
+                        case 'n':
+                            if(!readLiteral("null", m_str, m_idx))
+                                return fail(ParseErrc::INVALID_LITERAL, m_idx);
+                            if(!m_handler.on_null())
+                                return false;
+                            break;
+                        case 't':
+                            if(!readLiteral("true", m_str, m_idx))
+                                return fail(ParseErrc::INVALID_LITERAL, m_idx);
+                            if(!m_handler.on_bool(true))
+                                return false;
+                            break;
+                        case 'f':
+                            if(!readLiteral("false", m_str, m_idx))
+                                return fail(ParseErrc::INVALID_LITERAL, m_idx);
+                            if(!m_handler.on_bool(false))
+                                return false;
+                            break;
+                        case '\"':
+                        {
+                            std::string_view value;
+                            if(!readString(value) || !m_handler.on_string(value))
+                                return false;
+                            break;
+                        }
+                        case '[':
+                        case '{':
+                        {
+                            char open = m_str[m_idx++];
+                            if(!(open == '[' ? m_handler.start_array() : m_handler.start_object()))
+                                return false;
+                            m_stack.push_back(open);
+                            m_inside = false;
+                            parseWhitespace(m_str, m_idx);
+                            if(m_idx >= m_str.size())
+                                return fail(ParseErrc::UNEXPECTED_END, m_idx);
+                            if(m_str[m_idx] == (open == '[' ? ']' : '}'))
+                            {
+                                m_idx++;
+                                m_stack.pop_back();
+                                m_inside = true;
+                                if(!(open == '[' ? m_handler.end_array() : m_handler.end_object()))
+                                    return false;
+                                break;
+                            }
+                            m_inside = true;
+                            if(open == '{' && !readKey())
+                                return false;
+                            continue;
+                        }
+                        default:
+                        {
+                            const char * begin = m_str.data() + m_idx;
+                            const char * next = begin;
+                            NumberToken value;
+                            ParseErrc error = readNumber(begin, m_str.data() + m_str.size(), value, next, m_rawNumbers);
+                            if(error != ParseErrc::NONE)
+                                return fail(error, next - m_str.data());
+                            m_idx += next - begin;
+                            if(!emitNumber(m_handler, value, std::string_view(begin, next - begin)))
+                                return false;
+                        }
+                    }
+
+                    // 一个值结束: 读所在容器的逗号或结束符，可能一次关闭好几层
+                    while(1)
+                    {
+                        if(m_stack.empty())
+                            return true;
+                        m_inside = false;
+                        parseWhitespace(m_str, m_idx);
+                        if(m_idx >= m_str.size())
+                            return fail(ParseErrc::UNEXPECTED_END, m_idx);
+                        char open = m_stack.back();
+                        if(m_str[m_idx] == (open == '[' ? ']' : '}'))
+                        {
+                            m_idx++;
+                            m_stack.pop_back();
+                            m_inside = true;
+                            if(!(open == '[' ? m_handler.end_array() : m_handler.end_object()))
+                                return false;
+                            continue;
+                        }
+                        if(m_str[m_idx] != ',')
+                            return fail(open == '[' ? ParseErrc::EXPECTED_ARRAY_COMMA : ParseErrc::EXPECTED_OBJECT_COMMA, m_idx);
+                        m_idx++;
+                        m_inside = true;
+                        if(open == '{' && !readKey())
+                            return false;
+                        break;
+                    }
+                }
+            }
+
+            ParseErrc error() const { return m_error; }
+            size_t errorPosition() const { return m_errorPos; }
+
+        private:
+            bool fail(ParseErrc error, size_t pos)
+            {
+                m_error = error;
+                m_errorPos = pos;
+                return false;
+            }
+
+            // 按原来递归版本的规则给每一层容器加上前缀，加了前缀时位置是出错时的m_idx
+            // 最内层容器只在解析它的成员时出错才加前缀，外面各层总是加
+            [[noreturn]] void throwError() const
+            {
+                size_t levels = m_stack.size() - (m_stack.empty() || m_inside ? 0 : 1);
+                if(levels == 0)
+                    throwParseError(m_error, m_str, m_errorPos);
+                std::string message;
+                for(size_t i = 0; i < levels; i++)
+                    message += m_stack[i] == '[' ? "[ERROR]: array parse worng, " : "[ERROR]: object parse worng, ";
+                throw ghJsonException(message + errorMessage(m_error, m_str, m_errorPos), m_idx);
+            }
+
+            bool readString(std::string_view & value)
+            {
+                size_t pos = m_idx;
+                ParseErrc error = ghjson::readStringView(m_str, pos, m_buffer, value);
+                if(error != ParseErrc::NONE)
+                    return fail(error, pos);
+                m_idx = pos;
+                return true;
+            }
+
+            // 对象成员的键和冒号，之后m_idx指向值
+            bool readKey()
+            {
+                parseWhitespace(m_str, m_idx);
+                if(m_idx >= m_str.size())
+                    return fail(ParseErrc::UNEXPECTED_END, m_idx);
+                if(m_str[m_idx] != '\"')
+                    return fail(ParseErrc::EXPECTED_KEY, m_idx);
+                std::string_view key;
+                if(!readString(key) || !m_handler.on_key(key))
+                    return false;
+                parseWhitespace(m_str, m_idx);
+                if(m_idx >= m_str.size())
+                    return fail(ParseErrc::UNEXPECTED_END, m_idx);
+                if(m_str[m_idx] != ':')
+                    return fail(ParseErrc::EXPECTED_COLON, m_idx);
+                m_idx++;
+                return true;
+            }
+    };
+
+    bool Handler::on_raw_number(std::string_view text)
+    {
+        return on_number(rawToDouble(text));
+    }
+
+    bool parseSax(const std::string & in, Handler & handler)
+    {
+        Reader<Handler> reader(in, handler);
+        return reader.parseValue(0);
+    }
+
+    const size_t kInlineString = std::string().capacity();    // 不超过这个长度的字符串不用堆
+
+    //Parser缓存的节点: 只被池子持有，内容已经清空但保留容量；建树时代替makeShared
+    //新节点都从m_resource分配，也只缓存来自m_resource的节点
+    class NodePool
+    {
+        private:
+            std::pmr::memory_resource *        m_resource;
+            std::vector<Shared<std::string> *> m_strings;  // 字符串和RAW数字
+            std::vector<Shared<array> *>       m_arrays;
+            std::vector<Shared<object> *>      m_objects;
+#if GHJSON_OBJECT_BACKEND == GHJSON_OBJECT_MAP
+            std::vector<object::node_type>     m_members;  // 从std::map里摘下的成员节点，键保留容量
+#else
+            std::vector<std::string>           m_keys;     // 从对象里收回的键，保留容量
+#endif
+            std::vector<Json>                  m_walk;     // recycle的显式栈
+
+            template<typename T>
+            static Shared<T> * take(std::vector<Shared<T> *> & nodes)
+            {
+                if(nodes.empty())
+                    return nullptr;
+                Shared<T> * node = nodes.back();
+                nodes.pop_back();
+                return node;
+            }
+
+            // 只有这一份引用、而且和池子用同一个资源的节点才能缓存
+            template<typename T>
+            bool unique(const Shared<T> * node) const
+            {
+                return node->resource == m_resource && node->refs.load(std::memory_order_acquire) == 1;
+            }
+            // 池子自己的列表扩容也算分配
+            template<typename V, typename T>
+            void keep(V & list, T && item)
+            {
+                if(list.size() == list.capacity())
+                    allocations++;
+                list.push_back(std::forward<T>(item));
+            }
+            static bool hasNode(const Json & value)
+            {
+                return value.m_type >= JsonType::STRING || (value.m_type == JsonType::NUMBER && value.m_numberType == NumberType::RAW);
+            }
+        public:
+            size_t allocations = 0;
+
+            explicit NodePool(std::pmr::memory_resource * resource) : m_resource(resourceOr(resource)) {}
+            NodePool(const NodePool &) = delete;
+            NodePool& operator=(const NodePool &) = delete;
+            ~NodePool() { clear(); }
+
+            size_t size() const
+            {
+                size_t n = m_strings.size() + m_arrays.size() + m_objects.size();
+#if GHJSON_OBJECT_BACKEND == GHJSON_OBJECT_MAP
+                n += m_members.size();
+#else
+                n += m_keys.size();
+#endif
+                return n;
+            }
+
+            // 复用to的容量，不够时记一次分配
+            void assign(std::string & to, std::string_view from)
+            {
+                if(from.size() > to.capacity())
+                    allocations++;
+                to.assign(from.data(), from.size());
+            }
+
+            Json string(std::string_view value, NumberType type = NumberType::DOUBLE)
+            {
+                Json out;
+                if(Shared<std::string> * node = take(m_strings))
+                {
+                    out.m_string = node;
+                    assign(node->value, value);
+                }
+                else
+                {
+                    allocations += 1 + (value.size() > kInlineString);
+                    out.m_string = makeShared<std::string>(m_resource, value);
+                }
+                out.m_type = type == NumberType::RAW ? JsonType::NUMBER : JsonType::STRING;
+                out.m_numberType = type;
+                return out;
+            }
+
+            // Reader已经校验过原文
+            Json rawNumber(std::string_view text) { return string(text, NumberType::RAW); }
+
+            Json makeArray(Json * first, Json * last)
+            {
+                Json out;
+                if(Shared<array> * node = take(m_arrays))
+                {
+                    out.m_type = JsonType::ARRAY;
+                    out.m_array = node;
+                    if(node->value.capacity() < size_t(last - first))
+                        allocations++;
+                    node->value.assign(std::make_move_iterator(first), std::make_move_iterator(last));
+                }
+                else
+                {
+                    allocations += 1 + (first != last);
+                    out.m_array = makeShared<array>(m_resource, std::make_move_iterator(first), std::make_move_iterator(last), array::allocator_type(m_resource));
+                    out.m_type = JsonType::ARRAY;
+                }
+                return out;
+            }
+
+            // 重复的key保留第一个，和ObjectBuilder一致
+            Json makeObject(std::string * keys, Json * values, size_t count)
+            {
+                Json out;
+                if(Shared<object> * node = take(m_objects))
+                    out.m_object = node;
+                else
+                {
+                    out.m_object = makeContainer<object>(m_resource);
+                    allocations++;
+                }
+                out.m_type = JsonType::OBJECT;
+                object & members = out.m_object->value;
+#if GHJSON_OBJECT_BACKEND == GHJSON_OBJECT_MAP
+                for(size_t i = 0; i < count; i++)
+                {
+                    if(m_members.empty())
+                    {
+                        allocations += 1 + (keys[i].size() > kInlineString);
+                        members.emplace(keys[i], std::move(values[i]));
+                        continue;
+                    }
+                    object::node_type member = std::move(m_members.back());
+                    m_members.pop_back();
+                    assign(member.key(), keys[i]);
+                    member.mapped() = std::move(values[i]);
+                    auto result = members.insert(std::move(member));
+                    if(!result.inserted)
+                    {
+                        result.node.mapped() = Json();
+                        m_members.push_back(std::move(result.node));   // 刚取出一个，不会扩容
+                    }
+                }
+#else
+                size_t before = ObjectBuilder::capacity(members);
+                ObjectBuilder builder(std::move(members));
+                builder.reserve(count);
+                for(size_t i = 0; i < count; i++)
+                {
+                    std::string key;
+                    if(!m_keys.empty())
+                    {
+                        key = std::move(m_keys.back());
+                        m_keys.pop_back();
+                    }
+                    assign(key, keys[i]);
+                    builder.add(std::move(key), std::move(values[i]));
+                }
+                members = builder.finish();
+                if(ObjectBuilder::capacity(members) > before)
+                    allocations++;
+#endif
+                return out;
+            }
+
+            // 把json里只被它引用的节点拆下来缓存，其余的照常释放；显式栈遍历，不递归
+            void recycle(Json && json) noexcept
+            {
+                try
+                {
+                    keep(m_walk, std::move(json));
+                    while(!m_walk.empty())
+                    {
+                        Json value = std::move(m_walk.back());
+                        m_walk.pop_back();
+                        if(!hasNode(value))
+                            continue;
+                        if(value.m_type == JsonType::STRING || value.m_type == JsonType::NUMBER)
+                        {
+                            if(!unique(value.m_string))
+                                continue;
+                            keep(m_strings, value.m_string);
+                            value.m_string->value.clear();
+                        }
+                        else if(value.m_type == JsonType::ARRAY)
+                        {
+                            if(!unique(value.m_array))
+                                continue;
+                            for(Json & item : value.m_array->value)
+                                if(hasNode(item))
+                                    keep(m_walk, std::move(item));
+                            keep(m_arrays, value.m_array);
+                            value.m_array->value.clear();
+                        }
+                        else if(value.m_type == JsonType::OBJECT)
+                        {
+                            if(!unique(value.m_object))
+                                continue;
+                            object & members = value.m_object->value;
+#if GHJSON_OBJECT_BACKEND == GHJSON_OBJECT_MAP
+                            while(!members.empty())
+                            {
+                                object::node_type member = members.extract(members.begin());
+                                if(hasNode(member.mapped()))
+                                    keep(m_walk, std::move(member.mapped()));
+                                keep(m_members, std::move(member));
+                            }
+#else
+                            for(auto & member : members)
+                            {
+                                if(hasNode(member.second))
+                                    keep(m_walk, std::move(member.second));
+                                keep(m_keys, std::move(member.first));
+                            }
+#endif
+                            keep(m_objects, value.m_object);
+                            members.clear();
+                        }
+                        value.m_type = JsonType::NUL;   // 节点已经归池子所有
+                    }
+                }
+                catch(...)
+                {
+                    // 内存不足时剩下的照常释放
+                    m_walk.clear();
+                }
+            }
+
+            void clear() noexcept
+            {
+                for(auto node : m_strings)
+                    destroyShared(node);
+                for(auto node : m_arrays)
+                    destroyShared(node);
+                for(auto node : m_objects)
+                    destroyShared(node);
+                m_strings.clear();
+                m_arrays.clear();
+                m_objects.clear();
+#if GHJSON_OBJECT_BACKEND == GHJSON_OBJECT_MAP
+                m_members.clear();
+                m_members.shrink_to_fit();
+#else
+                std::vector<std::string>().swap(m_keys);
+#endif
+                m_strings.shrink_to_fit();
+                m_arrays.shrink_to_fit();
+                m_objects.shrink_to_fit();
+                m_walk.shrink_to_fit();
+            }
+    };
+
+    //把事件拼回Json树: 子节点先压在m_values上，容器结束时一次性移进去
+    //节点从m_resource分配(ParseOptions::resource)；设置了NodePool时从池子里取(Parser)
+    class TreeBuilder
+    {
+        private:
+            std::vector<Json>           m_values;
+            std::vector<std::string>    m_keys;    // 未闭合对象里已读到的键，前m_keyCount个有效，之后的留着容量
+            std::vector<size_t>         m_bases;   // 每个未闭合容器的第一个子节点在m_values里的位置
+            size_t                      m_keyCount;
+            NodePool *                  m_pool;
+            std::pmr::memory_resource * m_resource;
+
+            std::string & nextKey()
+            {
+                if(m_keyCount == m_keys.size())
+                    m_keys.emplace_back();
+                return m_keys[m_keyCount++];
+            }
+        public:
+            explicit TreeBuilder(std::pmr::memory_resource * resource = nullptr) : m_keyCount(0), m_pool(nullptr), m_resource(resourceOr(resource))
+            {
+                m_values.reserve(32);
+                m_keys.reserve(16);
+                m_bases.reserve(16);
+            }
+            void setPool(NodePool * pool) { m_pool = pool; }
+
+            bool on_null()                      { m_values.emplace_back(); return true; }
+            bool on_bool(bool value)            { m_values.emplace_back(value); return true; }
+            bool on_number(double value)        { m_values.emplace_back(value); return true; }
+            bool on_int64(int64_t value)        { m_values.emplace_back((long long)value); return true; }
+            bool on_uint64(uint64_t value)      { m_values.emplace_back((unsigned long long)value); return true; }
+            bool on_raw_number(std::string_view text) 
+            {
+                m_values.emplace_back(m_pool ? m_pool->rawNumber(text) : Json::rawNumber(text, m_resource)); 
+                return true; 
+            }
+            bool on_value(Json && value)        { m_values.emplace_back(std::move(value)); return true; }
+            bool on_string(std::string_view value) 
+            { 
+                m_values.emplace_back(m_pool ? m_pool->string(value) : Json(std::string(value), m_resource)); 
+                return true; 
+            }
+            // 有池子时只拷贝内容，value的容量留给调用方继续用
+            bool on_string(std::string && value)
+            {
+                m_values.emplace_back(m_pool ? m_pool->string(value) : Json(std::move(value), m_resource));
+                return true;
+            }
+            bool on_key(std::string_view key)
+            {
+                if(m_pool)
+                    m_pool->assign(nextKey(), key);
+                else
+                    nextKey().assign(key.data(), key.size());
+                return true;
+            }
+            bool on_key(std::string && key)
+            {
+                if(m_pool)
+                    m_pool->assign(nextKey(), key);
+                else
+                    nextKey() = std::move(key);
+                return true;
+            }
+            bool start_array()                  { m_bases.push_back(m_values.size()); return true; }
+            bool start_object()                 { m_bases.push_back(m_values.size()); return true; }
+
+            bool end_array()
+            {
+                size_t base = m_bases.back();
+                m_bases.pop_back();
+                Json out = m_pool ? m_pool->makeArray(m_values.data() + base, m_values.data() + m_values.size())
+                                  : Json(array(std::make_move_iterator(m_values.begin() + base), std::make_move_iterator(m_values.end()), m_resource));
+                m_values.resize(base);
+                m_values.emplace_back(std::move(out));
+                return true;
+            }
+
+            bool end_object()
+            {
+                size_t base = m_bases.back();
+                m_bases.pop_back();
+                size_t count = m_values.size() - base;
+                size_t keyBase = m_keyCount - count;
+                Json out;
+                if(m_pool)
+                    out = m_pool->makeObject(m_keys.data() + keyBase, m_values.data() + base, count);
+                else
+                {
+                    ObjectBuilder members(m_resource);
+                    members.reserve(count);
+                    for(size_t i = 0; i < count; i++)
+                        members.add(std::move(m_keys[keyBase + i]), std::move(m_values[base + i]));
+                    out = members.finish();
+                }
+                m_keyCount = keyBase;
+                m_values.resize(base);
+                m_values.emplace_back(std::move(out));
+                return true;
+            }
+
+            Json result() { return std::move(m_values.back()); }
+
+            // 出错后剩下的半成品交回池子
+            void clear()
+            {
+                if(m_pool)
+                    for(Json & value : m_values)
+                        m_pool->recycle(std::move(value));
+                m_values.clear();
+                m_keyCount = 0;
+                m_bases.clear();
+            }
+
+            size_t capacity() const { return m_values.capacity() + m_keys.capacity() + m_bases.capacity(); }
+            void shrink()
+            {
+                clear();
+                std::vector<Json>().swap(m_values);
+                std::vector<std::string>().swap(m_keys);
+                std::vector<size_t>().swap(m_bases);
+            }
+    };
+
+    Json parse(const std::string & in)
+    {
+        TreeBuilder builder;
+        Reader<TreeBuilder> reader(in, builder);
+        reader.parseValue(0);
+        return builder.result();
+    }
+
+    //按Projection过滤事件后交给TreeBuilder，被丢弃的值只经过Reader的语法检查
+    class ProjectionBuilder
+    {
+        private:
+            using Node = Projection::Node;
+            struct Frame
+            {
+                const Node * mask;
+                bool         array;
+            };
+            TreeBuilder        m_builder;
+            const Node *       m_root;
+            std::vector<Frame> m_frames;
+            const Node *       m_next;  // on_key算出的下一个值的规则，nullptr表示丢弃
+            std::string        m_key;   // 值确定保留时才交给TreeBuilder
+            size_t             m_skip;  // 大于0时处在被丢弃的容器里
+
+            // 当前值的规则: 数组里的元素沿用数组的规则
+            const Node * current() const
+            {
+                if(m_frames.empty())
+                    return m_root;
+                return m_frames.back().array ? m_frames.back().mask : m_next;
+            }
+
+            // 标量只在路径终点(或者就是根)时保留
+            bool keepScalar()
+            {
+                if(m_skip)
+                    return false;
+                const Node * mask = current();
+                if(!mask || (!mask->all && !m_frames.empty()))
+                    return false;
+                emitKey();
+                return true;
+            }
+
+            void emitKey()
+            {
+                if(!m_frames.empty() && !m_frames.back().array)
+                    m_builder.on_key(m_key);
+            }
+
+            bool start(bool array)
+            {
+                if(m_skip)
+                {
+                    m_skip++;
+                    return true;
+                }
+                const Node * mask = current();
+                if(!mask)
+                {
+                    m_skip = 1;
+                    return true;
+                }
+                emitKey();
+                m_frames.push_back(Frame{mask, array});
+                return array ? m_builder.start_array() : m_builder.start_object();
+            }
+
+            bool end(bool array)
+            {
+                if(m_skip)
+                {
+                    m_skip--;
+                    return true;
+                }
+                m_frames.pop_back();
+                return array ? m_builder.end_array() : m_builder.end_object();
+            }
+        public:
+            explicit ProjectionBuilder(const Projection & projection, std::pmr::memory_resource * resource = nullptr)
+                : m_builder(resource), m_root(&projection.root()), m_next(nullptr), m_skip(0) {}
+
+            bool on_null()                       { return !keepScalar() || m_builder.on_null(); }
+            bool on_bool(bool value)             { return !keepScalar() || m_builder.on_bool(value); }
+            bool on_number(double value)         { return !keepScalar() || m_builder.on_number(value); }
+            bool on_int64(int64_t value)         { return !keepScalar() || m_builder.on_int64(value); }
+            bool on_uint64(uint64_t value)       { return !keepScalar() || m_builder.on_uint64(value); }
+            bool on_raw_number(std::string_view text) { return !keepScalar() || m_builder.on_raw_number(text); }
+            bool on_string(std::string_view value) { return !keepScalar() || m_builder.on_string(value); }
+            bool on_key(std::string_view key)
+            {
+                if(m_skip)
+                    return true;
+                const Node * mask = m_frames.back().mask;
+                m_next = mask->all ? mask : mask->find(key);
+                if(m_next)
+                    m_key.assign(key.data(), key.size());
+                return true;
+            }
+            bool start_array()  { return start(true);  }
+            bool end_array()    { return end(true);    }
+            bool start_object() { return start(false); }
+            bool end_object()   { return end(false);   }
+
+            Json result() { return m_builder.result(); }
+
+            void setPool(NodePool * pool) { m_builder.setPool(pool); }
+            void clear()
+            {
+                m_builder.clear();
+                m_frames.clear();
+                m_next = nullptr;
+                m_skip = 0;
+            }
+            size_t capacity() const { return m_builder.capacity() + m_frames.capacity() + m_key.capacity(); }
+            void shrink()
+            {
+                clear();
+                m_builder.shrink();
+                std::vector<Frame>().swap(m_frames);
+                std::string().swap(m_key);
+            }
+    };
+
+    Json parseProjected(const std::string & in, const Projection & projection, const ParseOptions & options)
+    {
+        ProjectionBuilder builder(projection, options.resource);
+        Reader<ProjectionBuilder> reader(in, builder, 0, options.max_depth, options.raw_numbers);
+        reader.parseValue(0);
+        return builder.result();
+    }
+    //SAX
+    //file
+    //只读地打开一个文件: 能映射就映射，否则读进m_data
+    class MappedFile
+    {
+        private:
+            const char * m_map;
+            size_t       m_size;
+            std::string  m_data;
+        public:
+            explicit MappedFile(const std::string & path) : m_map(nullptr), m_size(0)
+            {
+#ifdef GHJSON_POSIX_FILE
+                int fd = open(path.c_str(), O_RDONLY);
+                if(fd < 0)
+                    throw ghJsonException("cannot open " + path + ": " + strerror(errno), 0);
+                struct stat st;
+                if(fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+                {
+                    void * map = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                    if(map != MAP_FAILED)
+                    {
+                        madvise(map, size_t(st.st_size), MADV_SEQUENTIAL);
+                        m_map = static_cast<const char *>(map);
+                        m_size = size_t(st.st_size);
+                        close(fd);
+                        return;
+                    }
+                }
+                // 管道、终端或者映射失败: 按块读
+                char buffer[64 * 1024];
+                while(1)
+                {
+                    ssize_t n = read(fd, buffer, sizeof(buffer));
+                    if(n == 0)
+                        break;
+                    if(n < 0)
+                    {
+                        if(errno == EINTR)
+                            continue;
+                        int error = errno;
+                        close(fd);
+                        throw ghJsonException("cannot read " + path + ": " + strerror(error), m_data.size());
+                    }
+                    m_data.append(buffer, size_t(n));
+                }
+                close(fd);
+#else
+                std::ifstream file(path, std::ios::binary);
+                if(!file)
+                    throw ghJsonException("cannot open " + path, 0);
+                char buffer[64 * 1024];
+                while(file.read(buffer, sizeof(buffer)) || file.gcount() > 0)
+                    m_data.append(buffer, size_t(file.gcount()));
+#endif
+            }
+            MappedFile(const MappedFile &) = delete;
+            MappedFile& operator=(const MappedFile &) = delete;
+            ~MappedFile()
+            {
+#ifdef GHJSON_POSIX_FILE
+                if(m_map)
+                    munmap(const_cast<char *>(m_map), m_size);
+#endif
+            }
+
+            std::string_view view() const { return m_map ? std::string_view(m_map, m_size) : std::string_view(m_data); }
+    };
+
+    Json parseFile(const std::string & path)
+    {
+        MappedFile file(path);
+        TreeBuilder builder;
+        Reader<TreeBuilder> reader(file.view(), builder);
+        reader.parseValue(0);
+        return builder.result();
+    }
+    //file
+    //lazy
+    // 找到下一个引号或括号: '['/'{'和']'/'}'只差0x20这一位，或上0x20后只需比较两次
+    inline const char * findStructural(const char * p, const char * end)
+    {
+#if defined(__SSE2__)
+        const __m128i quote = _mm_set1_epi8('\"');
+        const __m128i bit = _mm_set1_epi8(0x20);
+        const __m128i open = _mm_set1_epi8('{');
+        const __m128i close = _mm_set1_epi8('}');
+        for( ; end - p >= 16; p += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            __m128i folded = _mm_or_si128(v, bit);
+            __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_or_si128(_mm_cmpeq_epi8(folded, open), _mm_cmpeq_epi8(folded, close)));
+            int mask = _mm_movemask_epi8(hit);
+            if(mask)
+                return p + __builtin_ctz(mask);
+        }
+#endif
+        while(p != end && *p != '\"' && (*p | 0x20) != '{' && (*p | 0x20) != '}')
+            p++;
+        return p;
+    }
+
+    // p指向开头的引号，返回结尾引号之后
+    const char * skipString(const char * p, const char * begin, const char * end)
+    {
+        p++;
+        while(1)
+        {
+            p = findQuoteOrBackslash(p, end);
+            if(p == end)
+                throw ghJsonException("Unexpected end", end - begin);
+            if(*p == '\"')
+                return p + 1;
+            p = end - p > 2 ? p + 2 : end;   // 反斜杠是最后一个字节时不能越过end
+        }
+    }
+
+    // 跳过idx处的值，返回值之后的位置。只匹配引号和括号，标量读到分隔符为止
+    size_t skipValue(std::string_view str, size_t idx, size_t depth, size_t maxDepth)
+    {
+        const char * begin = str.data();
+        const char * end = begin + str.size();
+        const char * p = begin + idx;
+        if(*p == '\"')
+            return skipString(p, begin, end) - begin;
+        if(*p != '[' && *p != '{')
+        {
+            while(p != end && *p != ',' && *p != ']' && *p != '}' && *p != ' ' && *p != '\n' && *p != '\r' && *p != '\t')
+                p++;
+            return p - begin;
+        }
+        std::string closers;
+        while(1)
+        {
+            p = findStructural(p, end);
+            if(p == end)
+                throw ghJsonException("Unexpected end", str.size());
+            switch(*p)
+            {
+                case '\"':
+                    p = skipString(p, begin, end);
+                    continue;
+                case '[':
+                case '{':
+                    if(depth + closers.size() > maxDepth)
+                        throw ghJsonException("exceeded maximum nesting depth", p - begin);
+                    closers.push_back(*p == '[' ? ']' : '}');
+                    break;
+                default:
+                    if(closers.back() != *p)
+                        throw ghJsonException("[ERROR]: mismatched " + std::string(1, *p), p - begin);
+                    closers.pop_back();
+                    if(closers.empty())
+                        return p + 1 - begin;
+            }
+            p++;
+        }
+    }
+
+    JsonType LazyValue::type() const
+    {
+        if(m_pos == std::string_view::npos)
+            throw ghJsonException("Bad LazyValue access: value is empty", 0);
+        switch(m_str[m_pos])
+        {
+            case 'n':  return JsonType::NUL;
+            case 't':
+            case 'f':  return JsonType::BOOL;
+            case '\"': return JsonType::STRING;
+            case '[':  return JsonType::ARRAY;
+            case '{':  return JsonType::OBJECT;
+            default:
+                if(m_str[m_pos] == '-' || isDigit(m_str[m_pos]))
+                    return JsonType::NUMBER;
+                throw ghJsonException("[ERROR]: unexpected character " + std::string(1, m_str[m_pos]), m_pos);
+        }
+    }
+
+    void checkLazy(const LazyValue & value, JsonType tag, const char * func)
+    {
+        JsonType type = value.type();
+        if(type != tag)
+            throw ghJsonException("Invalid type:  Attempted to call " + std::string(func) + " on a LazyValue of type " + ToString(type), 0);
+    }
+
+    // 值后面只能是空白再跟 , ] } 或者输入结束，否则和完整解析一样报错(比如"[12abc]")
+    void checkLazyEnd(std::string_view str, size_t idx)
+    {
+        parseWhitespace(str, idx);
+        if(idx < str.size() && str[idx] != ',' && str[idx] != ']' && str[idx] != '}')
+            throw ghJsonException("[ERROR]: unexpected character after value", idx);
+    }
+
+    double LazyValue::getNumber() const
+    {
+        checkLazy(*this, JsonType::NUMBER, __func__);
+        size_t idx = m_pos;
+        Json value = parseNumber(m_str, idx);
+        checkLazyEnd(m_str, idx);
+        return value.getNumber();
+    }
+
+    int64_t LazyValue::getInt64() const
+    {
+        checkLazy(*this, JsonType::NUMBER, __func__);
+        size_t idx = m_pos;
+        Json value = parseNumber(m_str, idx);
+        checkLazyEnd(m_str, idx);
+        return value.getInt64();
+    }
+
+    uint64_t LazyValue::getUint64() const
+    {
+        checkLazy(*this, JsonType::NUMBER, __func__);
+        size_t idx = m_pos;
+        Json value = parseNumber(m_str, idx);
+        checkLazyEnd(m_str, idx);
+        return value.getUint64();
+    }
+
+    bool LazyValue::getBool() const
+    {
+        checkLazy(*this, JsonType::BOOL, __func__);
+        size_t idx = m_pos;
+        matchLiteral(m_str[m_pos] == 't' ? "true" : "false", m_str, idx);
+        checkLazyEnd(m_str, idx);
+        return m_str[m_pos] == 't';
+    }
+
+    std::string LazyValue::getString() const
+    {
+        checkLazy(*this, JsonType::STRING, __func__);
+        size_t idx = m_pos;
+        std::string out;
+        parseStringTo(m_str, idx, out);
+        checkLazyEnd(m_str, idx);
+        return out;
+    }
+
+    std::string_view LazyValue::raw() const
+    {
+        type();
+        return m_str.substr(m_pos, skipValue(m_str, m_pos, m_depth, m_maxDepth) - m_pos);
+    }
+
+    // 依次把容器里每个元素的位置(对象还有解码后的键)交给f，f返回true时停止
+    template<typename F>
+    void forEachLazy(std::string_view str, size_t pos, size_t depth, size_t maxDepth, bool isObject, F && f)
+    {
+        char close = isObject ? '}' : ']';
+        std::string buffer;
+        std::string_view key;
+        size_t idx = pos + 1;
+        parseWhitespace(str, idx);
+        checkIndex(str, idx);
+        if(str[idx] == close)
+            return;
+        if(depth + 1 > maxDepth)
+            throw ghJsonException("exceeded maximum nesting depth", idx);
+        while(1)
+        {
+            if(isObject)
+            {
+                if(str[idx] != '\"')
+                    throw ghJsonException("[ERROR]: object parsing, expect key", idx);
+                key = parseStringView(str, idx, buffer);
+                parseWhitespace(str, idx);
+                checkIndex(str, idx);
+                if(str[idx] != ':')
+                    throw ghJsonException("[ERROR]: object parsing, expect':', got " + std::string(1, str[idx]), idx);
+                idx++;
+                parseWhitespace(str, idx);
+                checkIndex(str, idx);
+            }
+            if(f(key, idx))
+                return;
+            idx = skipValue(str, idx, depth + 1, maxDepth);
+            parseWhitespace(str, idx);
+            checkIndex(str, idx);
+            if(str[idx] == close)
+                return;
+            if(str[idx] != ',')
+                throw ghJsonException(isObject ? "[ERROR]: object format worng, " : "[ERROR]: array format worng, ", idx);
+            idx++;
+            parseWhitespace(str, idx);
+            checkIndex(str, idx);
+        }
+    }
+
+    size_t LazyValue::size() const
+    {
+        JsonType tag = type();
+        if(tag != JsonType::ARRAY && tag != JsonType::OBJECT)
+            throw ghJsonException("Invalid type:  Attempted to call " + std::string(__func__) + " on a LazyValue of type " + ToString(tag), 0);
+        size_t n = 0;
+        forEachLazy(m_str, m_pos, m_depth, m_maxDepth, tag == JsonType::OBJECT, [&](std::string_view, size_t) { n++; return false; });
+        return n;
+    }
+
+    LazyValue LazyValue::find(size_t index) const
+    {
+        LazyValue out;
+        if(*this && type() == JsonType::ARRAY)
+        {
+            size_t i = 0;
+            forEachLazy(m_str, m_pos, m_depth, m_maxDepth, false, [&](std::string_view, size_t idx)
+            {
+                if(i++ != index)
+                    return false;
+                out = LazyValue(m_str, idx, m_depth + 1, m_maxDepth);
+                return true;
+            });
+        }
+        return out;
+    }
+
+    LazyValue LazyValue::find(std::string_view key) const
+    {
+        LazyValue out;
+        if(*this && type() == JsonType::OBJECT)
+        {
+            forEachLazy(m_str, m_pos, m_depth, m_maxDepth, true, [&](std::string_view name, size_t idx)
+            {
+                if(name != key)
+                    return false;
+                out = LazyValue(m_str, idx, m_depth + 1, m_maxDepth);
+                return true;
+            });
+        }
+        return out;
+    }
+
+    LazyValue LazyValue::operator[](size_t index) const
+    {
+        checkLazy(*this, JsonType::ARRAY, __func__);
+        LazyValue out = find(index);
+        if(!out)
+            throw ghJsonException(std::string(__func__) + "index out of range!", 0);
+        return out;
+    }
+
+    LazyValue LazyValue::operator[](std::string_view key) const
+    {
+        checkLazy(*this, JsonType::OBJECT, __func__);
+        LazyValue out = find(key);
+        if(!out)
+            throw ghJsonException(std::string(__func__) + " key :[" + std::string(key) + "] not exits! ", 0);
+        return out;
+    }
+
+    Json LazyValue::toJson() const
+    {
+        type();
+        TreeBuilder builder;
+        Reader<TreeBuilder> reader(m_str, builder, m_pos, m_maxDepth);
+        reader.parseValue(m_depth);
+        checkLazyEnd(m_str, reader.position());
+        return builder.result();
+    }
+
+    LazyValue parseLazy(const std::string & in, const ParseOptions & options)
+    {
+        size_t idx = 0;
+        parseWhitespace(in, idx);
+        checkIndex(in, idx);
+        return LazyValue(in, idx, 0, options.max_depth);
+    }
+    //lazy
+    //stream
+    //把TreeBuilder包成Handler，StreamParser不传Handler时用它建树
+    class TreeHandler : public Handler
+    {
+        public:
+            TreeBuilder builder;
+            bool on_null() override                    { return builder.on_null(); }
+            bool on_bool(bool value) override          { return builder.on_bool(value); }
+            bool on_number(double value) override      { return builder.on_number(value); }
+            bool on_int64(int64_t value) override      { return builder.on_int64(value); }
+            bool on_uint64(uint64_t value) override    { return builder.on_uint64(value); }
+            bool on_raw_number(std::string_view text) override { return builder.on_raw_number(text); }
+            bool on_string(std::string_view value) override { return builder.on_string(value); }
+            bool on_key(std::string_view key) override { return builder.on_key(key); }
+            bool start_object() override               { return builder.start_object(); }
+            bool end_object() override                 { return builder.end_object(); }
+            bool start_array() override                { return builder.start_array(); }
+            bool end_array() override                  { return builder.end_array(); }
     };
 
-    class NullClass
+    inline bool isWhitespace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+    inline bool isNumberChar(char c) { return isDigit(c) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E'; }
+
+    StreamParser::StreamParser() : m_builder(new TreeHandler()), m_handler(m_builder.get()), m_maxDepth(ParseOptions().max_depth) { reset(); }
+    StreamParser::StreamParser(Handler & handler) : m_handler(&handler), m_maxDepth(ParseOptions().max_depth) { reset(); }
+    StreamParser::~StreamParser() = default;
+
+    void StreamParser::reset()
+    {
+        if(m_builder)
+            static_cast<TreeHandler *>(m_builder.get())->builder.clear();
+        m_stack.clear();
+        m_token.clear();
+        m_chunk = nullptr;
+        m_offset = 0;
+        m_expect = Expect::VALUE;
+        m_tokenType = Token::NONE;
+        m_escaped = false;
+        m_hasEscape = false;
+        m_stopped = false;
+    }
+
+    bool StreamParser::feed(const char * data, size_t size)
+    {
+        if(m_stopped)
+            return false;
+        m_chunk = data;
+        const char * p = data;
+        const char * end = data + size;
+        if(m_tokenType != Token::NONE)
+            p = continueToken(p, end);
+
+        while(p != end && !m_stopped)
+        {
+            char c = *p;
+            if(isWhitespace(c))
+            {
+                p++;
+                continue;
+            }
+            switch(m_expect)
+            {
+                case Expect::ARRAY_FIRST:
+                    if(c == ']')
+                    {
+                        p++;
+                        closeContainer();
+                        break;
+                    }
+                    p = startValue(p, end);
+                    break;
+                case Expect::VALUE:
+                    p = startValue(p, end);
+                    break;
+                case Expect::OBJECT_FIRST:
+                case Expect::KEY:
+                    if(c == '}' && m_expect == Expect::OBJECT_FIRST)
+                    {
+                        p++;
+                        closeContainer();
+                        break;
+                    }
+                    if(c != '\"')
+                        throw ghJsonException("[ERROR]: object parsing, expect key", position(p));
+                    m_tokenType = Token::KEY;
+                    m_token.assign(1, '\"');
+                    m_escaped = false;
+                    m_hasEscape = false;
+                    p = continueToken(p + 1, end);
+                    break;
+                case Expect::COLON:
+                    if(c != ':')
+                        throw ghJsonException("[ERROR]: object parsing, expect':', got " + std::string(1, c), position(p));
+                    m_expect = Expect::VALUE;
+                    p++;
+                    break;
+                case Expect::NEXT:
+                {
+                    bool inArray = m_stack.back() == '[';
+                    if(c == ',')
+                    {
+                        m_expect = inArray ? Expect::VALUE : Expect::KEY;
+                        p++;
+                    }
+                    else if(c == (inArray ? ']' : '}'))
+                    {
+                        p++;
+                        closeContainer();
+                    }
+                    else
+                    {
+                        throw ghJsonException(inArray ? "[ERROR]: array format worng, " : "[ERROR]: object format worng, ", position(p));
+                    }
+                    break;
+                }
+                case Expect::END:
+                    throw ghJsonException("[ERROR]: unexpected character after value", position(p));
+            }
+        }
+        m_offset += size;
+        return !m_stopped;
+    }
+
+    bool StreamParser::finish()
     {
-        public:
-            bool operator == (NullClass) const { return true; }
-            bool operator < (NullClass)  const { return false; }
-    };
+        if(m_stopped)
+            return false;
+        if(m_tokenType == Token::NUMBER || m_tokenType == Token::LITERAL)
+            finishScalar(m_token.data(), m_token.data() + m_token.size(), m_offset - m_token.size());
+        else if(m_tokenType != Token::NONE)
+            decodeString(m_offset - m_token.size());   // 没闭合的字符串: 先报里面的转义错误，否则是Unexpected end
+        if(m_tokenType != Token::NONE || m_expect != Expect::END)
+            throw ghJsonException("Unexpected end", m_offset);
+        return !m_stopped;
+    }
 
-    class JsonNull : public Value<JsonType::NUL, NullClass>
+    Json StreamParser::result()
     {
-        public:
-            explicit JsonNull() : Value(NullClass()) {};
-            //clone
-            virtual std::unique_ptr<JsonValue> clone() const override{ return std::make_unique<JsonNull>(); }
-            //clone
-            void dump(std::string &out, size_t depth) const { out += "null"; }
-    };
+        if(!m_builder)
+            throw ghJsonException("StreamParser::result() is only available without a Handler", 0);
+        if(m_tokenType != Token::NONE || m_expect != Expect::END)
+            throw ghJsonException("Unexpected end", m_offset);
+        return static_cast<TreeHandler *>(m_builder.get())->builder.result();
+    }
 
-    class JsonBool : public Value<JsonType::BOOL, bool>
+    const char * StreamParser::startValue(const char * p, const char * end)
     {
-        public:
-            explicit JsonBool(bool value) : Value(value) {};
-        private:
-            //getValue
-            bool getBool() const override { return m_value; }
-            //getValue
-            //setvalue
-            void setBool (bool value) override { m_value = value; }
-            //setvalue
-            //clone
-            virtual std::unique_ptr<JsonValue> clone() const override{ return std::make_unique<JsonBool>(m_value); }
-            //clone
-            //dump
-            void dump(std::string &out, size_t depth) const { out += (m_value ? "true" : "false"); }
-            //dump
-    };
+        if(m_stack.size() > m_maxDepth)
+        {
+            throw ghJsonException("exceeded maximum nesting depth", position(p));
+        }
+        char c = *p;
+        switch(c)
+        {
+            case '[':
+                m_stack.push_back(c);
+                m_expect = Expect::ARRAY_FIRST;
+                m_stopped = !m_handler->start_array();
+                return p + 1;
+            case '{':
+                m_stack.push_back(c);
+                m_expect = Expect::OBJECT_FIRST;
+                m_stopped = !m_handler->start_object();
+                return p + 1;
+            case '\"':
+                m_tokenType = Token::STRING;
+                m_token.assign(1, '\"');
+                m_escaped = false;
+                m_hasEscape = false;
+                return continueToken(p + 1, end);
+            case 'n':
+            case 't':
+            case 'f':
+                m_tokenType = Token::LITERAL;
+                m_token.clear();
+                return continueToken(p, end);
+            default:
+                if(c != '-' && !isDigit(c))
+                    throw ghJsonException("[ERROR]: unexpected character " + std::string(1, c), position(p));
+                m_tokenType = Token::NUMBER;
+                m_token.clear();
+                return continueToken(p, end);
+        }
+    }
 
-    class JsonNumber : public Value<JsonType::NUMBER, double>
+    // 继续读当前token，读完就发出事件；这一块读完还没结束就先存进m_token
+    const char * StreamParser::continueToken(const char * p, const char * end)
     {
-        public:
-            explicit JsonNumber(double value) : Value(value) {};
-        private:
-            //getValue
-            double getNumber() const override { return m_value; }
-            //getValue
-            //setvalue
-            void setNumber(double value) override { m_value = value; }
-            //setvalue
-            //clone
-            virtual std::unique_ptr<JsonValue> clone() const override{ return std::make_unique<JsonNumber>(m_value); }
-            //clone
-            //dump
-            void dump(std::string &out, size_t depth) const { out += std::to_string(m_value); }
-            //dump
-    };
+        const char * begin = p;
+        if(m_tokenType == Token::NUMBER || m_tokenType == Token::LITERAL)
+        {
+            if(m_tokenType == Token::NUMBER)
+                while(p != end && isNumberChar(*p))
+                    p++;
+            else
+                while(p != end && *p >= 'a' && *p <= 'z')
+                    p++;
+            if(p == end)
+            {
+                m_token.append(begin, p - begin);
+                return p;
+            }
+            if(m_token.empty())
+            {
+                finishScalar(begin, p, position(begin));
+            }
+            else
+            {
+                m_token.append(begin, p - begin);
+                finishScalar(m_token.data(), m_token.data() + m_token.size(), position(p) - m_token.size());
+            }
+            return p;
+        }
+
+        while(p != end)
+        {
+            if(m_escaped)
+            {
+                m_escaped = false;
+                p++;
+                continue;
+            }
+            const char * q = findQuoteOrBackslash(p, end);
+            if(q == end)
+                break;
+            if(*q == '\\')
+            {
+                m_escaped = true;
+                m_hasEscape = true;
+                p = q + 1;
+                continue;
+            }
+
+            std::string_view value;
+            if(m_token.size() == 1 && !m_hasEscape)
+            {
+                // 整个字符串都在这一块里，不用拷贝
+                value = std::string_view(begin, q - begin);
+            }
+            else
+            {
+                m_token.append(begin, q + 1 - begin);
+                value = decodeString(position(q) + 1 - m_token.size());
+            }
+            Token type = m_tokenType;
+            m_tokenType = Token::NONE;
+            if(type == Token::KEY)
+            {
+                m_stopped = !m_handler->on_key(value);
+                m_expect = Expect::COLON;
+            }
+            else
+            {
+                m_stopped = !m_handler->on_string(value);
+                valueDone();
+            }
+            return q + 1;
+        }
+        m_token.append(begin, end - begin);
+        return end;
+    }
 
-    class JsonString : public Value<JsonType::STRING, std::string>
+    // 解码m_token里攒下的字符串，start是开头引号在整个输入里的偏移
+    // 出错位置换算成整个输入里的偏移，和parse()报的一致
+    std::string_view StreamParser::decodeString(size_t start)
     {
-        public:
-            explicit JsonString(const std::string& value) : Value(value) {}
-            explicit JsonString(std::string&& value) : Value(move(value)) {}
-        private:
-            //getValue
-            const std::string & getString() const override { return m_value; }
-            //getValue
-            //setvalue
-            void setString (const std::string & value) override { m_value = value; }
-            //setvalue
-            //clone
-            virtual std::unique_ptr<JsonValue> clone() const override{ return std::make_unique<JsonString>(m_value); }
-            //clone
-            //dump
-            void dump(std::string &out, size_t depth) const { out += "\"" + m_value + "\""; }
-            //dump
+        size_t pos = 0;
+        std::string_view value;
+        ParseErrc error = readStringView(m_token, pos, m_buffer, value);
+        if(error != ParseErrc::NONE)
+            throw ghJsonException(errorMessage(error, m_token, pos), start + pos);
+        return value;
+    }
+
+    void StreamParser::finishScalar(const char * begin, const char * end, size_t pos)
+    {
+        Token type = m_tokenType;
+        m_tokenType = Token::NONE;
+        if(type == Token::NUMBER)
+        {
+            const char * next = begin;
+            NumberToken value = scanNumber(begin, end, pos, next);
+            if(next != end)
+                throw ghJsonException("Invalid number format", pos + (next - begin));
+            m_stopped = !emitNumber(*m_handler, value, std::string_view(begin, end - begin));
+        }
+        else
+        {
+            std::string_view literal(begin, end - begin);
+            if(literal == "null")
+                m_stopped = !m_handler->on_null();
+            else if(literal == "true")
+                m_stopped = !m_handler->on_bool(true);
+            else if(literal == "false")
+                m_stopped = !m_handler->on_bool(false);
+            else
+                throw ghJsonException("[ERROR]:expected literal, got (" + std::string(literal) + ")", pos);
+        }
+        valueDone();
+    }
+
+    void StreamParser::closeContainer()
+    {
+        char open = m_stack.back();
+        m_stack.pop_back();
+        m_stopped = !(open == '[' ? m_handler->end_array() : m_handler->end_object());
+        valueDone();
+    }
+
+    void StreamParser::valueDone()
+    {
+        m_expect = m_stack.empty() ? Expect::END : Expect::NEXT;
+    }
+    //stream
+    //ndjson
+    struct Record
+    {
+        size_t begin;
+        size_t end;
     };
 
-    class JsonArray : public Value<JsonType::ARRAY, array>
+    // 按换行切成记录，字符串里的换行不算；只有空白的行跳过
+    void splitRecords(std::string_view in, std::vector<Record> & out)
     {
-        public:
-            explicit JsonArray(const array& value) : Value(value) {};
-            explicit JsonArray(array&& value) : Value(move(value)) {};        
-        private:
-            //getValue
-            const array & getArray() const override { return m_value; }
-            //getValue
-            //setvalue
-            void setArray (const array & value) override { m_value = value; }
-            void addToArray (const Json & value) override{ m_value.emplace_back(value);}
-            void removeFromArray (size_t index) override
+        const char * base = in.data();
+        const char * end = base + in.size();
+        const char * start = base;
+        const char * p = base;
+        auto add = [&](const char * last)
+        {
+            for(const char * c = start; c != last; c++)
             {
-                if (index < m_value.size()) 
-                {
-                    m_value.erase(m_value.begin() + index);
-                }
-                else
+                if(!isWhitespace(*c))
                 {
-                    throw ghJsonException(std::string(__func__) + "index out of range!", 0);
+                    out.push_back(Record{size_t(start - base), size_t(last - base)});
+                    return;
                 }
             }
-            //setvalue
-            //operator[]
-            Json & operator[] (size_t index) override
+        };
+        while(1)
+        {
+            const char * q = findEither(p, end, '\"', '\n');
+            if(q == end)
+                break;
+            if(*q == '\n')
+            {
+                add(q);
+                start = p = q + 1;
+                continue;
+            }
+            // 跳过整个字符串
+            p = q + 1;
+            while(1)
             {
-                if (index < m_value.size()) 
+                q = findQuoteOrBackslash(p, end);
+                if(q == end)
                 {
-                    return m_value[index];
+                    p = end;
+                    break;
                 }
-                else
+                if(*q == '\"')
                 {
-                    throw ghJsonException(std::string(__func__) + "index out of range!", 0);
+                    p = q + 1;
+                    break;
                 }
+                p = end - q > 2 ? q + 2 : end;
             }
-            const Json & operator[] (size_t index) const override
+        }
+        add(end);
+    }
+
+    Json parseRecord(std::string_view in, const Record & record, TreeBuilder & builder)
+    {
+        std::string_view text = in.substr(record.begin, record.end - record.begin);
+        try
+        {
+            builder.clear();
+            Reader<TreeBuilder> reader(text, builder);
+            reader.parseValue(0);
+            size_t idx = reader.position();
+            parseWhitespace(text, idx);
+            if(idx != text.size())
+                throw ghJsonException("[ERROR]: unexpected character after value", idx);
+            return builder.result();
+        }
+        catch(const ghJsonException& ex)
+        {
+            throw ghJsonException(ex.what(), record.begin + ex.getPosition());
+        }
+    }
+
+    // 每个线程一次领取一批记录；出错时其他线程领完手上这批就停，最后抛出序号最小的错误
+    template<typename F>
+    void forEachRecord(std::string_view in, const std::vector<Record> & records, size_t threads, F && onRecord)
+    {
+        const size_t kBatch = 64;
+        if(threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        threads = std::max<size_t>(1, std::min(threads, (records.size() + kBatch - 1) / kBatch));
+
+        std::atomic<size_t> next(0);
+        std::atomic<bool> failed(false);
+        std::vector<std::exception_ptr> errors(threads);
+        std::vector<size_t> errorIndex(threads, SIZE_MAX);
+        auto work = [&](size_t id)
+        {
+            TreeBuilder builder;
+            while(!failed.load(std::memory_order_relaxed))
             {
-                if (index < m_value.size()) 
+                size_t first = next.fetch_add(kBatch);
+                if(first >= records.size())
+                    return;
+                size_t last = std::min(first + kBatch, records.size());
+                for(size_t i = first; i < last; i++)
                 {
-                    return m_value[index];
+                    try
+                    {
+                        onRecord(i, parseRecord(in, records[i], builder));
+                    }
+                    catch(...)
+                    {
+                        errors[id] = std::current_exception();
+                        errorIndex[id] = i;
+                        failed = true;
+                        return;
+                    }
                 }
-                else
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for(size_t id = 1; id < threads; id++)
+            workers.emplace_back(work, id);
+        work(0);
+        for(auto & worker : workers)
+            worker.join();
+
+        size_t first = std::min_element(errorIndex.begin(), errorIndex.end()) - errorIndex.begin();
+        if(errors[first])
+            std::rethrow_exception(errors[first]);
+    }
+
+    std::vector<Json> collectRecords(std::string_view in, size_t threads)
+    {
+        std::vector<Record> records;
+        splitRecords(in, records);
+        std::vector<Json> out(records.size());
+        forEachRecord(in, records, threads, [&out](size_t index, Json && value) { out[index] = std::move(value); });
+        return out;
+    }
+
+    std::vector<Json> parseNdjson(const std::string & in, size_t threads)
+    {
+        return collectRecords(in, threads);
+    }
+
+    std::vector<Json> parseNdjsonFile(const std::string & path, size_t threads)
+    {
+        MappedFile file(path);
+        return collectRecords(file.view(), threads);
+    }
+
+    void parseNdjson(const std::string & in, RecordHandler & handler, size_t threads)
+    {
+        std::vector<Record> records;
+        splitRecords(in, records);
+        forEachRecord(in, records, threads, [&handler](size_t index, Json && value) { handler.on_record(index, std::move(value)); });
+    }
+    //ndjson
+    //parse
+    //structural index
+    //每64字节一块，每个字符对应掩码里的一位
+    struct BlockMasks
+    {
+        uint64_t quote;
+        uint64_t backslash;
+        uint64_t op;         // { } [ ] : ,
+        uint64_t whitespace;
+    };
+
+    struct ScalarClassifier
+    {
+        void operator()(const char * block, BlockMasks & masks) const
+        {
+            masks = BlockMasks{0, 0, 0, 0};
+            for(int i = 0; i < 64; i++)
+            {
+                uint64_t bit = uint64_t(1) << i;
+                switch(block[i])
                 {
-                    throw ghJsonException(std::string(__func__) + "index out of range!", 0);
+                    case '\"': masks.quote |= bit; break;
+                    case '\\': masks.backslash |= bit; break;
+                    case '{': case '}': case '[': case ']': case ':': case ',': masks.op |= bit; break;
+                    case ' ': case '\t': case '\n': case '\r': masks.whitespace |= bit; break;
+                    default: break;
                 }
             }
-            //operator[]
-            //clone
-            virtual std::unique_ptr<JsonValue> clone() const override{ return std::make_unique<JsonArray>(m_value); }
-            //clone
-            //dump
-            void dump(std::string &out, size_t depth) const 
+        }
+    };
+
+#if defined(__GNUC__) && defined(__x86_64__)
+    #define GHJSON_X86_SIMD 1
+    struct SSE2Classifier
+    {
+        static __m128i eq(__m128i v, char c) { return _mm_cmpeq_epi8(v, _mm_set1_epi8(c)); }
+
+        void operator()(const char * block, BlockMasks & masks) const
+        {
+            masks = BlockMasks{0, 0, 0, 0};
+            for(int i = 0; i < 4; i++)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + 16 * i));
+                __m128i op = _mm_or_si128(_mm_or_si128(_mm_or_si128(eq(v, '{'), eq(v, '}')), _mm_or_si128(eq(v, '['), eq(v, ']'))), _mm_or_si128(eq(v, ':'), eq(v, ',')));
+                __m128i ws = _mm_or_si128(_mm_or_si128(eq(v, ' '), eq(v, '\t')), _mm_or_si128(eq(v, '\n'), eq(v, '\r')));
+                int shift = 16 * i;
+                masks.quote      |= uint64_t(uint16_t(_mm_movemask_epi8(eq(v, '\"'))))  << shift;
+                masks.backslash  |= uint64_t(uint16_t(_mm_movemask_epi8(eq(v, '\\')))) << shift;
+                masks.op         |= uint64_t(uint16_t(_mm_movemask_epi8(op)))           << shift;
+                masks.whitespace |= uint64_t(uint16_t(_mm_movemask_epi8(ws)))           << shift;
+            }
+        }
+    };
+
+    //按低4位查表: 空白字符查到的是自己；把[ ]变成{ }之后，结构字符查到的也是自己
+    //(少数控制字符会被误判为结构字符，它们本来就不能出现在字符串外面，第二阶段会报错)
+    struct AVX2Classifier
+    {
+        __attribute__((target("avx2")))
+        void operator()(const char * block, BlockMasks & masks) const
+        {
+            const __m256i wsTable = _mm256_setr_epi8(' ', 100, 100, 100, 17, 100, 113, 2, 100, '\t', '\n', 112, 100, '\r', 100, 100,
+                                                     ' ', 100, 100, 100, 17, 100, 113, 2, 100, '\t', '\n', 112, 100, '\r', 100, 100);
+            const __m256i opTable = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ':', '{', ',', '}', 0, 0,
+                                                     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ':', '{', ',', '}', 0, 0);
+            masks = BlockMasks{0, 0, 0, 0};
+            for(int i = 0; i < 2; i++)
+            {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + 32 * i));
+                __m256i ws = _mm256_cmpeq_epi8(v, _mm256_shuffle_epi8(wsTable, v));
+                __m256i op = _mm256_cmpeq_epi8(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), _mm256_shuffle_epi8(opTable, v));
+                int shift = 32 * i;
+                masks.quote      |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\"')))))  << shift;
+                masks.backslash  |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))))) << shift;
+                masks.op         |= uint64_t(uint32_t(_mm256_movemask_epi8(op))) << shift;
+                masks.whitespace |= uint64_t(uint32_t(_mm256_movemask_epi8(ws))) << shift;
+            }
+        }
+    };
+#endif
+
+    // 前缀异或: 第i位 = 第0..i位的异或
+    inline uint64_t prefixXor(uint64_t x)
+    {
+        x ^= x << 1;
+        x ^= x << 2;
+        x ^= x << 4;
+        x ^= x << 8;
+        x ^= x << 16;
+        x ^= x << 32;
+        return x;
+    }
+
+    //逐块扫描，Classifier负责把64字节分类成掩码；每种指令集各有一个flatten的入口，把整个循环内联进去
+    //字符串没有闭合时返回false
+    template<typename Classifier>
+    inline bool scanBlocks(const std::string & in, std::vector<uint32_t> & out, Classifier classify)
+    {
+        size_t count = 0;
+        out.resize(in.size() / 4 + 64);
+
+        uint64_t escapedCarry = 0;  // 上一块以未被转义的反斜杠结尾
+        uint64_t inStringCarry = 0; // 上一块结束时仍在字符串里
+        uint64_t scalarCarry = 0;   // 上一块以非引号的标量字符结尾
+        char tail[64];
+        for(size_t base = 0; base < in.size(); base += 64)
+        {
+            const char * block = in.data() + base;
+            if(in.size() - base < 64)
+            {
+                memset(tail, ' ', sizeof(tail));
+                memcpy(tail, block, in.size() - base);
+                block = tail;
+            }
+            BlockMasks masks;
+            classify(block, masks);
+
+            // 被转义的字符: 从左到右处理反斜杠，已经被转义的反斜杠不再转义下一个字符
+            uint64_t escaped = escapedCarry;
+            escapedCarry = 0;
+            for(uint64_t bits = masks.backslash; bits; bits &= bits - 1)
+            {
+                int i = __builtin_ctzll(bits);
+                if(escaped & (uint64_t(1) << i))
+                    continue;
+                if(i == 63)
+                    escapedCarry = 1;
+                else
+                    escaped |= uint64_t(1) << (i + 1);
+            }
+
+            uint64_t quote = masks.quote & ~escaped;
+            uint64_t inString = prefixXor(quote) ^ inStringCarry; // 包含开引号，不含闭引号
+            inStringCarry = uint64_t(int64_t(inString) >> 63);
+            uint64_t stringTail = inString ^ quote;                // 字符串内容和闭引号
+
+            uint64_t scalar = ~(masks.op | masks.whitespace);
+            uint64_t nonQuoteScalar = scalar & ~quote;
+            uint64_t followsScalar = (nonQuoteScalar << 1) | scalarCarry;
+            scalarCarry = nonQuoteScalar >> 63;
+
+            // 补齐的尾部都是空格，不会产生多余的位置
+            uint64_t structurals = (masks.op | (scalar & ~followsScalar)) & ~stringTail;
+            if(count + 64 > out.size())
+                out.resize(std::max(out.size() * 2, count + 64));
+            uint32_t * begin = out.data() + count;
+            uint32_t * dst = begin;
+            for( ; structurals; structurals &= structurals - 1)
+                *dst++ = uint32_t(base + __builtin_ctzll(structurals));
+            count += dst - begin;
+        }
+        out.resize(count);
+        return !inStringCarry;
+    }
+
+    __attribute__((flatten))
+    bool scanScalar(const std::string & in, std::vector<uint32_t> & out) { return scanBlocks(in, out, ScalarClassifier()); }
+#ifdef GHJSON_X86_SIMD
+    __attribute__((flatten))
+    bool scanSSE2(const std::string & in, std::vector<uint32_t> & out) { return scanBlocks(in, out, SSE2Classifier()); }
+    __attribute__((target("avx2"), flatten))
+    bool scanAVX2(const std::string & in, std::vector<uint32_t> & out) { return scanBlocks(in, out, AVX2Classifier()); }
+#endif
+
+    using ScanFn = bool (*)(const std::string &, std::vector<uint32_t> &);
+
+    ScanFn selectScanner()
+    {
+#ifdef GHJSON_X86_SIMD
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx2"))
+            return scanAVX2;
+        return scanSSE2;
+#else
+        return scanScalar;
+#endif
+    }
+
+    // 输入要先确认不超过UINT32_MAX
+    bool readStructurals(const std::string & in, std::vector<uint32_t> & out)
+    {
+        static const ScanFn scan = selectScanner();
+        return scan(in, out);
+    }
+
+    void scanStructurals(const std::string & in, std::vector<uint32_t> & out)
+    {
+        if(in.size() > UINT32_MAX)
+            throw ghJsonException("input too large for structural index", 0);
+        if(!readStructurals(in, out))
+            throw ghJsonException("Unexpected end", in.size());
+    }
+
+    //结构索引只能记32位的偏移；第一阶段在引号配不平时失败，第一个值之后的内容不完整也会这样
+    //这两种情况解析时都改用Reader，接受的输入和报错都和不用索引时一致
+    bool tryStructurals(const std::string & in, std::vector<uint32_t> & out)
+    {
+        return in.size() <= UINT32_MAX && readStructurals(in, out);
+    }
+
+    //第二阶段: 沿着结构索引建树，标量仍然从原始输入里解析
+    //和Reader一样读完第一个完整的值就结束，之后的内容不再检查
+    class IndexedParser
+    {
+        private:
+            const std::string & m_str;
+            const std::vector<uint32_t> & m_index;
+            size_t m_next;
+            size_t m_maxDepth;
+            bool m_rawNumbers;
+            ParseErrc m_error;
+            size_t m_errorPos;
+        public:
+            IndexedParser(const std::string & str, const std::vector<uint32_t> & index, size_t maxDepth, bool rawNumbers) 
+                : m_str(str), m_index(index), m_next(0), m_maxDepth(maxDepth), m_rawNumbers(rawNumbers), m_error(ParseErrc::NONE), m_errorPos(0) {}
+
+            Json parse(std::pmr::memory_resource * resource = nullptr)
+            {
+                Json out;
+                if(!read(out, resource))
+                    throwParseError(m_error, m_str, m_errorPos);
+                return out;
+            }
+
+            // 不抛异常的版本，出错时返回false，error()和errorPosition()给出错误码和位置
+            bool read(Json & out, std::pmr::memory_resource * resource = nullptr)
+            {
+                TreeBuilder builder(resource);
+                std::string stack, buffer;
+                return read(out, builder, stack, buffer);
+            }
+
+            // 和Reader一样用显式栈，不递归；stack和buffer是未闭合的容器和字符串解码缓冲，Parser复用它们
+            bool read(Json & out, TreeBuilder & builder, std::string & stack, std::string & buffer)
             {
-                out += '[';
-                bool first = true;
-                for (const auto& item : m_value)
+                stack.clear();
+                size_t idx = 0;
+                while(1)
                 {
-                    if (!first)
+                    if(stack.size() > m_maxDepth)
+                        return fail(ParseErrc::DEPTH_EXCEEDED, peek());
+                    if(!advance(idx))
+                        return false;
+                    switch(m_str[idx])
+                    {
+                        case '{':
+                        case '[':
+                        {
+                            char open = m_str[idx];
+                            char close = open == '[' ? ']' : '}';
+                            open == '[' ? builder.start_array() : builder.start_object();
+                            if(m_next < m_index.size() && m_str[m_index[m_next]] == close)
+                            {
+                                m_next++;
+                                open == '[' ? builder.end_array() : builder.end_object();
+                                break;
+                            }
+                            stack.push_back(open);
+                            if(open == '{' && !readKey(builder, buffer))
+                                return false;
+                            continue;
+                        }
+                        case '\"':
+                        {
+                            buffer.clear();
+                            ParseErrc error = readString(m_str, idx, buffer);
+                            if(error != ParseErrc::NONE)
+                                return fail(error, idx);
+                            if(!stack.empty() && !checkScalarEnd(idx))
+                                return false;
+                            builder.on_string(std::move(buffer));
+                            break;
+                        }
+                        case 'n':
+                        case 't':
+                        case 'f':
+                        {
+                            char c = m_str[idx];
+                            if(!readLiteral(c == 'n' ? "null" : c == 't' ? "true" : "false", m_str, idx))
+                                return fail(ParseErrc::INVALID_LITERAL, idx);
+                            if(!stack.empty() && !checkScalarEnd(idx))
+                                return false;
+                            c == 'n' ? builder.on_null() : builder.on_bool(c == 't');
+                            break;
+                        }
+                        case '}': case ']': case ':': case ',':
+                            return fail(ParseErrc::UNEXPECTED_CHARACTER, idx);
+                        default:
+                        {
+                            const char * begin = m_str.data() + idx;
+                            const char * next = begin;
+                            NumberToken value;
+                            ParseErrc error = readNumber(begin, m_str.data() + m_str.size(), value, next, m_rawNumbers);
+                            if(error != ParseErrc::NONE)
+                                return fail(error, next - m_str.data());
+                            if(!stack.empty() && !checkScalarEnd(next - m_str.data()))
+                                return false;
+                            emitNumber(builder, value, std::string_view(begin, next - begin));
+                        }
+                    }
+
+                    while(1)
                     {
-                        out += ", ";
+                        if(stack.empty())
+                        {
+                            out = builder.result();
+                            return true;
+                        }
+                        char open = stack.back();
+                        if(!advance(idx))
+                            return false;
+                        if(m_str[idx] == (open == '[' ? ']' : '}'))
+                        {
+                            stack.pop_back();
+                            open == '[' ? builder.end_array() : builder.end_object();
+                            continue;
+                        }
+                        if(m_str[idx] != ',')
+                            return fail(open == '[' ? ParseErrc::EXPECTED_ARRAY_COMMA : ParseErrc::EXPECTED_OBJECT_COMMA, idx);
+                        if(open == '{' && !readKey(builder, buffer))
+                            return false;
+                        break;
                     }
-                    first = false;
-                    item.dump(out, depth+1);
-                }
-                out += ']';
-            }
-            //dump
-            //iterator
-            arrayiter arrayBegin() override {  return m_value.begin(); }
-            const_arrayiter arrayBegin_const() const override { return m_value.cbegin();}
-            arrayiter arrayEnd() override {  return m_value.end(); }
-            const_arrayiter arrayEnd_const() const override { return m_value.cend();}
-            //iterator
+                }
+            }
+
+            ParseErrc error() const { return m_error; }
+            size_t errorPosition() const { return m_errorPos; }
+
+        private:
+            bool fail(ParseErrc error, size_t pos)
+            {
+                m_error = error;
+                m_errorPos = pos;
+                return false;
+            }
+
+            size_t peek() const { return m_next < m_index.size() ? m_index[m_next] : m_str.size(); }
+
+            bool advance(size_t & idx)
+            {
+                if(m_next == m_index.size())
+                    return fail(ParseErrc::UNEXPECTED_END, m_str.size());
+                idx = m_index[m_next++];
+                return true;
+            }
+
+            // 容器里的标量之后到下一个结构字符之间只能有空白
+            bool checkScalarEnd(size_t end)
+            {
+                size_t stop = peek();
+                for( ; end < stop; end++)
+                {
+                    char c = m_str[end];
+                    if(c != ' ' && c != '\t' && c != '\n' && c != '\r')
+                        return fail(ParseErrc::UNEXPECTED_CHARACTER, end);
+                }
+                return true;
+            }
+
+            bool readKey(TreeBuilder & builder, std::string & buffer)
+            {
+                size_t idx = 0;
+                if(!advance(idx))
+                    return false;
+                if(m_str[idx] != '\"')
+                    return fail(ParseErrc::EXPECTED_KEY, idx);
+                buffer.clear();
+                ParseErrc error = readString(m_str, idx, buffer);
+                if(error != ParseErrc::NONE)
+                    return fail(error, idx);
+                if(!checkScalarEnd(idx))
+                    return false;
+                builder.on_key(std::move(buffer));
+
+                if(!advance(idx))
+                    return false;
+                if(m_str[idx] != ':')
+                    return fail(ParseErrc::EXPECTED_COLON, idx);
+                return true;
+            }
     };
 
-    class JsonObject : public Value<JsonType::OBJECT, object>
+    Json parse(const std::string & in, const ParseOptions & options)
     {
-        public:
-            explicit JsonObject(const object& value) : Value(value) {};
-            explicit JsonObject(object&& value) : Value(move(value)) {};
-        private:
-            //getValue
-            const object & getObject() const override { return m_value; }
-            //getValue
-            //setvalue
-            void setObject (const object & value) override { m_value = value; }
-            void addToObject(const std::string & key, const Json & value){ m_value[key] = value; }
-            void removeFromObject (const std::string& key) override
+        if(options.projection)
+            return parseProjected(in, *options.projection, options);
+        if(options.structural_index)
+        {
+            std::vector<uint32_t> index;
+            if(tryStructurals(in, index))
+            {
+                IndexedParser parser(in, index, options.max_depth, options.raw_numbers);
+                return parser.parse(options.resource);
+            }
+        }
+        TreeBuilder builder(options.resource);
+        Reader<TreeBuilder> reader(in, builder, 0, options.max_depth, options.raw_numbers);
+        reader.parseValue(0);
+        return builder.result();
+    }
+    // 出错位置换算成行列，只在出错时调用
+    void setError(ParseError & err, ParseErrc code, std::string_view str, size_t offset)
+    {
+        offset = std::min(offset, str.size());
+        size_t lineStart = offset == 0 ? std::string_view::npos : str.rfind('\n', offset - 1);
+        err.code = code;
+        err.offset = offset;
+        err.line = 1 + std::count(str.begin(), str.begin() + offset, '\n');
+        err.column = offset - (lineStart == std::string_view::npos ? 0 : lineStart + 1) + 1;
+    }
+
+    template<typename B>
+    bool readTree(const std::string & in, B & builder, const ParseOptions & options, Json & out, ParseErrc & error, size_t & pos)
+    {
+        Reader<B> reader(in, builder, 0, options.max_depth, options.raw_numbers);
+        if(reader.read(0))
+        {
+            out = builder.result();
+            return true;
+        }
+        error = reader.error();
+        pos = reader.errorPosition();
+        return false;
+    }
+
+    bool parse(const std::string & in, Json & out, ParseError & err, const ParseOptions & options) noexcept
+    {
+        err = ParseError();
+        ParseErrc error = ParseErrc::NONE;
+        size_t pos = 0;
+        try
+        {
+            if(options.projection)
             {
-                auto iter = m_value.find(key);
-                if(iter == m_value.end())
+                ProjectionBuilder builder(*options.projection, options.resource);
+                if(readTree(in, builder, options, out, error, pos))
+                    return true;
+            }
+            else
+            {
+                std::vector<uint32_t> index;
+                if(options.structural_index && tryStructurals(in, index))
                 {
-                    throw ghJsonException(std::string(__func__) + " key :[" + key + "] not exits! ", 0);
+                    IndexedParser parser(in, index, options.max_depth, options.raw_numbers);
+                    if(parser.read(out, options.resource))
+                        return true;
+                    error = parser.error();
+                    pos = parser.errorPosition();
                 }
                 else
-                    m_value.erase(iter);
+                {
+                    TreeBuilder builder(options.resource);
+                    if(readTree(in, builder, options, out, error, pos))
+                        return true;
+                }
+            }
+        }
+        catch(...)
+        {
+            // 语法错误都不走异常，能到这里的只有分配失败
+            error = ParseErrc::OUT_OF_MEMORY;
+            pos = 0;
+        }
+        setError(err, error, in, pos);
+        return false;
+    }
+    //structural index
+    //reusable parser
+    //一个Parser的全部状态: 三种建树方式各自的读取器和缓冲都留着，节点来自pool
+    class ParserState
+    {
+        public:
+            ParseOptions                       options;
+            NodePool                           pool;
+            TreeBuilder                        builder;
+            Reader<TreeBuilder>                reader;
+            std::vector<uint32_t>              index;
+            std::string                        stack;
+            std::string                        buffer;
+            std::unique_ptr<ProjectionBuilder> projection;
+            std::unique_ptr<Reader<ProjectionBuilder>> projectionReader;
+
+            explicit ParserState(const ParseOptions & opts)
+                : options(opts), pool(opts.resource), builder(opts.resource), reader(std::string_view(), builder, 0, opts.max_depth, opts.raw_numbers)
+            {
+                builder.setPool(&pool);
+                if(options.projection)
+                {
+                    projection.reset(new ProjectionBuilder(*options.projection, options.resource));
+                    projection->setPool(&pool);
+                    projectionReader.reset(new Reader<ProjectionBuilder>(std::string_view(), *projection, 0, opts.max_depth, opts.raw_numbers));
+                }
+            }
+
+            size_t capacity() const
+            {
+                size_t n = builder.capacity() + reader.capacity() + index.capacity() + stack.capacity() + buffer.capacity();
+                if(projection)
+                    n += projection->capacity() + projectionReader->capacity();
+                return n;
+            }
+
+            // 和ghjson::parse走同样的路径；throwing为true时出错抛出同样的异常，否则返回false并给出错误码和位置
+            // 缓冲在这一次里扩了容就记一次分配
+            bool read(const std::string & in, Json & out, bool throwing, ParseErrc & error, size_t & pos)
+            {
+                size_t before = capacity();
+                bool ok = readOnce(in, out, throwing, error, pos);
+                if(capacity() > before)
+                    pool.allocations++;
+                return ok;
             }
-            //setvalue
-            //operator[]
-            Json & operator[](const std::string& key) override { return m_value[key]; }
-            const Json & operator[](const std::string& key) const override 
-            { 
-                auto iter = m_value.find(key);
-                if(iter == m_value.end())
+
+            void shrink()
+            {
+                builder.shrink();
+                reader.shrink();
+                if(projection)
                 {
-                    throw ghJsonException(std::string(__func__) + " key :[" + key + "] not exits! ", 0);
+                    projection->shrink();
+                    projectionReader->shrink();
                 }
-                else
-                    return iter->second;
+                pool.clear();
+                std::vector<uint32_t>().swap(index);
+                std::string().swap(stack);
+                std::string().swap(buffer);
             }
-            //operator[]
-            //clone
-            virtual std::unique_ptr<JsonValue> clone() const override{ return std::make_unique<JsonObject>(m_value); }
-            //clone
-            //dump
-            void dump(std::string &out, size_t depth) const 
+        private:
+            bool readOnce(const std::string & in, Json & out, bool throwing, ParseErrc & error, size_t & pos)
             {
-                bool first = true;
-                for (const auto& item : m_value)
+                if(projection)
                 {
-                    
-                    if (!first)
+                    projection->clear();
+                    projectionReader->reset(in);
+                    if(throwing ? projectionReader->parseValue(0) : projectionReader->read(0))
                     {
-                        out += ",\n";
-                        for(size_t i = 0; i < depth; i++)
-                        {
-                            out+='\t';
-                        }
+                        out = projection->result();
+                        return true;
                     }
-                    else
+                    error = projectionReader->error();
+                    pos = projectionReader->errorPosition();
+                    return false;
+                }
+                builder.clear();
+                if(!options.structural_index || !tryStructurals(in, index))
+                {
+                    reader.reset(in);
+                    if(throwing ? reader.parseValue(0) : reader.read(0))
                     {
-                        out+= '{';
+                        out = builder.result();
+                        return true;
                     }
-                    first = false;
-                    
-                    out += item.first + " : ";
-                    item.second.dump(out, depth+1);
-                }
-                out += '}';
-            }
-            //dump
-            //iterator
-            objectiter objectBegin() override {  return m_value.begin(); }
-            const_objectiter objectBegin_const() const override{ return m_value.cbegin();}
-            objectiter objectEnd() override {  return m_value.end(); }
-            const_objectiter objectEnd_const() const override{ return m_value.cend();}
-            //iterator
+                    error = reader.error();
+                    pos = reader.errorPosition();
+                    return false;
+                }
+                IndexedParser parser(in, index, options.max_depth, options.raw_numbers);
+                if(parser.read(out, builder, stack, buffer))
+                    return true;
+                if(throwing)
+                    throwParseError(parser.error(), in, parser.errorPosition());
+                error = parser.error();
+                pos = parser.errorPosition();
+                return false;
+            }
     };
-    //JsonValue
 
-    //Json
-    //constructor
-    Json::Json() noexcept                : m_ptr(std::make_unique<JsonNull>()) {}
-    Json::Json(std::nullptr_t) noexcept  : m_ptr(std::make_unique<JsonNull>()) {}
-    Json::Json(int value)                : m_ptr(std::make_unique<JsonNumber>(double(value))) {}
-    Json::Json(double value)             : m_ptr(std::make_unique<JsonNumber>(value)) {}
-    Json::Json(bool value)               : m_ptr(std::make_unique<JsonBool>(value)) {}
-    Json::Json(const std::string &value) : m_ptr(std::make_unique<JsonString>(value)) {}
-    Json::Json(std::string &&value)      : m_ptr(std::make_unique<JsonString>(move(value))) {}
-    Json::Json(const char * value)       : m_ptr(std::make_unique<JsonString>(value)) {}
-    Json::Json(const array &values)      : m_ptr(std::make_unique<JsonArray>(values)) {}
-    Json::Json(array &&values)           : m_ptr(std::make_unique<JsonArray>(move(values))) {}
-    Json::Json(const object &values)     : m_ptr(std::make_unique<JsonObject>(values)) {}
-    Json::Json(object &&values)          : m_ptr(std::make_unique<JsonObject>(move(values))) {}
-
-    Json::Json(const Json & other) : m_ptr(other.m_ptr ? other.m_ptr->clone() : std::make_unique<JsonNull>()) {}
-    Json::Json(Json && other) noexcept : m_ptr(std::move(other.m_ptr)){}
-    Json& Json::operator=(const Json& other) 
+    Parser::Parser(const ParseOptions & options) : m_state(new ParserState(options)) {}
+    Parser::Parser(Parser &&) noexcept = default;
+    Parser& Parser::operator=(Parser &&) noexcept = default;
+    Parser::~Parser() = default;
+
+    Json Parser::parse(const std::string & in)
     {
-        if (this != &other) // 防止自赋值
-        { 
-            m_ptr = other.m_ptr ? other.m_ptr->clone() : std::make_unique<JsonNull>(); //避免有nullptr
+        Json out;
+        ParseErrc error = ParseErrc::NONE;
+        size_t pos = 0;
+        m_state->read(in, out, true, error, pos);
+        return out;
+    }
+
+    bool Parser::parse(const std::string & in, Json & out, ParseError & err) noexcept
+    {
+        err = ParseError();
+        ParseErrc error = ParseErrc::NONE;
+        size_t pos = 0;
+        try
+        {
+            Json value;
+            if(m_state->read(in, value, false, error, pos))
+            {
+                std::swap(out, value);
+                m_state->pool.recycle(std::move(value));
+                return true;
+            }
         }
-        return *this;
+        catch(...)
+        {
+            error = ParseErrc::OUT_OF_MEMORY;
+            pos = 0;
+        }
+        setError(err, error, in, pos);
+        return false;
     }
-    Json& Json::operator=(Json&& other) noexcept 
+
+    void Parser::recycle(Json && json) noexcept { m_state->pool.recycle(std::move(json)); }
+    void Parser::shrink() noexcept { m_state->shrink(); }
+    size_t Parser::allocations() const { return m_state->pool.allocations; }
+    size_t Parser::cachedNodes() const { return m_state->pool.size(); }
+    //reusable parser
+    //Arena
+    Arena::Arena(size_t chunkSize) noexcept 
+        : m_head(nullptr), m_cur(nullptr), m_end(nullptr), m_chunkSize(chunkSize), m_capacity(0) {}
+
+    Arena::Arena(Arena && other) noexcept 
+        : m_head(other.m_head), m_cur(other.m_cur), m_end(other.m_end), m_chunkSize(other.m_chunkSize), m_capacity(other.m_capacity)
+    {
+        other.m_head = nullptr;
+        other.m_cur = other.m_end = nullptr;
+        other.m_capacity = 0;
+    }
+
+    Arena& Arena::operator=(Arena && other) noexcept
     {
         if (this != &other) // 防止自赋值
-        { 
-            m_ptr = std::move(other.m_ptr) ; //避免有nullptr
+        {
+            clear();
+            std::swap(m_head, other.m_head);
+            std::swap(m_cur, other.m_cur);
+            std::swap(m_end, other.m_end);
+            std::swap(m_chunkSize, other.m_chunkSize);
+            std::swap(m_capacity, other.m_capacity);
         }
         return *this;
     }
-    //constructor
-    //type
-    JsonType Json::type()      const { return m_ptr->type();              }
-    bool     Json::is_null()   const { return type() == JsonType::NUL;    }
-    bool     Json::is_number() const { return type() == JsonType::NUMBER; }
-    bool     Json::is_bool()   const { return type() == JsonType::BOOL;   }
-    bool     Json::is_string() const { return type() == JsonType::STRING; }
-    bool     Json::is_array()  const { return type() == JsonType::ARRAY;  }
-    bool     Json::is_object() const { return type() == JsonType::OBJECT; }
-    //type
-    //getValue
-    double Json::getNumber() const { check(); return m_ptr->getNumber(); }
-    bool Json::getBool() const { check(); return m_ptr->getBool(); }
-    const std::string & Json::getString() const { check(); return m_ptr->getString(); }
-    const array & Json::getArray()  const { check(); return m_ptr->getArray(); }
-    const object & Json::getObject() const { check(); return m_ptr->getObject(); }
-    //getValue
-    //setValue
-    void Json::setNumber(double value) { check(); return m_ptr->setNumber(value); }
-    void Json::setBool(bool value) { check(); return m_ptr->setBool(value); }
-    void Json::setString(const std::string & value) { check(); return m_ptr->setString(value); }
-    void Json::setArray(const array & value) { check(); return m_ptr->setArray(value); }
-    void Json::setObject(const object & value) { check(); return m_ptr->setObject(value); }
-
-    void Json::addToArray (const Json & value) { check(); return m_ptr->addToArray(value); }
-    void Json::addToObject(const std::string & key, const Json & value) { check(); return m_ptr->addToObject(key, value); }
-    void Json::removeFromArray(size_t index) { check(); return m_ptr->removeFromArray(index); }
-    void Json::removeFromObject(const std::string& key) { check(); return m_ptr->removeFromObject(key); }
-    //setValue
-    //operator[]
-    Json & Json::operator[](size_t i) { check(); return (*m_ptr)[i]; }
-    Json & Json::operator[](const std::string &key) { check(); return (*m_ptr)[key]; }
-    const Json & Json::operator[](size_t i) const { check(); return (*m_ptr)[i]; }
-    const Json & Json::operator[](const std::string &key) const { check(); return (*m_ptr)[key]; }
-    //operator[]
-    //operator==
-    bool Json::operator== (const Json &rhs) const
+
+    void * Arena::allocate(size_t size, size_t align)
     {
-        check();
-        if(m_ptr == rhs.m_ptr)
-            return true;
-        else if(type() != rhs.type())
-            return false;
-        else
-            return m_ptr->equals(rhs.m_ptr.get());
+        uintptr_t cur = reinterpret_cast<uintptr_t>(m_cur);
+        uintptr_t aligned = (cur + align - 1) & ~uintptr_t(align - 1);
+        if(m_cur == nullptr || aligned + size > reinterpret_cast<uintptr_t>(m_end))
+        {
+            // 块大小翻倍增长，最大1MB；超大的请求单独占一块
+            size_t chunkSize = m_capacity == 0 ? m_chunkSize : std::min<size_t>(m_capacity, 1 << 20);
+            chunkSize = std::max(chunkSize, size + align + sizeof(Chunk));
+            Chunk * chunk = static_cast<Chunk *>(::operator new(chunkSize));
+            chunk->next = m_head;
+            chunk->size = chunkSize;
+            m_head = chunk;
+            m_cur = reinterpret_cast<char *>(chunk + 1);
+            m_end = reinterpret_cast<char *>(chunk) + chunkSize;
+            m_capacity += chunkSize;
+            cur = reinterpret_cast<uintptr_t>(m_cur);
+            aligned = (cur + align - 1) & ~uintptr_t(align - 1);
+        }
+        m_cur = reinterpret_cast<char *>(aligned + size);
+        return reinterpret_cast<void *>(aligned);
     }
-    bool Json::operator< (const Json &rhs) const
+
+    void Arena::clear() noexcept
     {
-        check();
-        if (m_ptr == rhs.m_ptr)
-            return false;
-        else if (m_ptr->type() != rhs.m_ptr->type())
-            return m_ptr->type() < rhs.m_ptr->type();
-        else
-            return m_ptr->less(rhs.m_ptr.get());
+        while(m_head)
+        {
+            Chunk * next = m_head->next;
+            ::operator delete(m_head);
+            m_head = next;
+        }
+        m_cur = m_end = nullptr;
+        m_capacity = 0;
     }
-    //operator==
-    //dump
-    const std::string Json::dump() const
+    //Arena
+    //KeyPool
+    KeyPool::KeyPool() noexcept : m_arena(1024), m_size(0), m_frozen(false), m_hits(0), m_misses(0) {}
+
+    const KeyPool::Slot * KeyPool::lookup(std::string_view key, uint32_t hash) const
     {
-        std::string str;
-        size_t depth = 0;
-        dump(str, depth);
-        return str;
+        if(m_slots.empty())
+            return nullptr;
+        size_t mask = m_slots.size() - 1;
+        for(size_t i = hash & mask; m_slots[i].s; i = (i + 1) & mask)
+        {
+            const Slot & slot = m_slots[i];
+            if(slot.hash == hash && slot.size == key.size() && memcmp(slot.s, key.data(), key.size()) == 0)
+                return &slot;
+        }
+        return nullptr;
     }
-    void Json::dump(std::string &out, size_t depth) const 
-    { 
-        check();
-        m_ptr->dump(out, depth); 
+
+    std::string_view KeyPool::insert(std::string_view key, uint32_t hash)
+    {
+        if(key.size() > UINT32_MAX)
+            throw ghJsonException("key too long", 0);
+        if((m_size + 1) * 2 > m_slots.size())
+        {
+            std::vector<Slot> old(std::max<size_t>(64, m_slots.size() * 2), Slot{nullptr, 0, 0});
+            old.swap(m_slots);
+            size_t mask = m_slots.size() - 1;
+            for(const Slot & slot : old)
+            {
+                if(!slot.s)
+                    continue;
+                size_t i = slot.hash & mask;
+                while(m_slots[i].s)
+                    i = (i + 1) & mask;
+                m_slots[i] = slot;
+            }
+        }
+        char * data = m_arena.allocate<char>(key.size() + 1);
+        memcpy(data, key.data(), key.size());
+        data[key.size()] = '\0';
+        size_t mask = m_slots.size() - 1;
+        size_t i = hash & mask;
+        while(m_slots[i].s)
+            i = (i + 1) & mask;
+        m_slots[i] = Slot{data, uint32_t(key.size()), hash};
+        m_size++;
+        return std::string_view(data, key.size());
     }
-    //dump
-    //iterator
-    arrayiter Json::arrayBegin() { check(); return m_ptr->arrayBegin(); }
-    const_arrayiter Json::arrayBegin_const() const { check(); return m_ptr->arrayBegin_const();}
-    arrayiter Json::arrayEnd() { check(); return m_ptr->arrayEnd(); }
-    const_arrayiter Json::arrayEnd_const() const { check(); return m_ptr->arrayEnd_const();}    
-    objectiter Json::objectBegin(){ check(); return m_ptr->objectBegin();}
-    const_objectiter Json::objectBegin_const() const { check(); return m_ptr->objectBegin_const();}
-    objectiter Json::objectEnd(){ check(); return m_ptr->objectEnd();}
-    const_objectiter Json::objectEnd_const() const { check(); return m_ptr->objectEnd_const();}
-    //iterator
-    //Json
-    //parse
-    void checkIndex(const std::string& str, size_t idx) 
+
+    std::string_view KeyPool::seed(std::string_view key)
     {
-        if (idx >= str.size()) 
+        uint32_t hash = uint32_t(std::hash<std::string_view>()(key));
+        if(const Slot * slot = lookup(key, hash))
+            return std::string_view(slot->s, slot->size);
+        return insert(key, hash);
+    }
+
+    // 统计先记在调用方的局部变量里，解析完一个文档再一次性加上，避免每个键两次原子操作
+    std::string_view KeyPool::intern(std::string_view key, size_t & hits, size_t & misses)
+    {
+        uint32_t hash = uint32_t(std::hash<std::string_view>()(key));
+        if(const Slot * slot = lookup(key, hash))
         {
-            throw ghJsonException("Unexpected end", idx);
+            hits++;
+            return std::string_view(slot->s, slot->size);
         }
+        misses++;
+        if(m_frozen)
+            return std::string_view();
+        return insert(key, hash);
     }
 
-    //提前声明
-    Json parseJson(const std::string & str, size_t & idx, size_t depth);
-    Json parseString(const std::string & str, size_t & idx);
-    
-    void parseWhitespace(const std::string& str, size_t & idx)
+    void KeyPool::addStats(size_t hits, size_t misses)
     {
-        while (idx < str.size() && (str[idx] == ' ' || str[idx] == '\r' || str[idx] == '\n' || str[idx] == '\t'))
-            idx++;
+        m_hits.fetch_add(hits, std::memory_order_relaxed);
+        m_misses.fetch_add(misses, std::memory_order_relaxed);
     }
 
-    Json parseObject(const std::string & str, size_t & idx, size_t depth) 
+    std::string_view KeyPool::intern(std::string_view key)
     {
-        object out;
+        size_t hits = 0, misses = 0;
+        std::string_view interned = intern(key, hits, misses);
+        addStats(hits, misses);
+        return interned;
+    }
 
-        parseWhitespace(str, idx);
-        checkIndex(str, idx);
+    std::string_view KeyPool::find(std::string_view key) const
+    {
+        const Slot * slot = lookup(key, uint32_t(std::hash<std::string_view>()(key)));
+        return slot ? std::string_view(slot->s, slot->size) : std::string_view();
+    }
 
-        if(str[idx] == '}')
-            return Json(out);
+    double KeyPool::hitRate() const
+    {
+        size_t total = hits() + misses();
+        return total ? double(hits()) / total : 0;
+    }
 
-        while(1)
+    void KeyPool::resetStats()
+    {
+        m_hits.store(0, std::memory_order_relaxed);
+        m_misses.store(0, std::memory_order_relaxed);
+    }
+    //KeyPool
+    //DocValue
+    const DocNode & checkNode(const DocNode * node, JsonType tag, const char * func)
+    {
+        if(node == nullptr)
+            throw ghJsonException("Bad DocValue access: node is null", 0);
+        if(node->tag != tag)
+            throw ghJsonException("Invalid type:  Attempted to call " + std::string(func) + " on a DocValue of type " + ToString(node->tag), 0);
+        return *node;
+    }
+
+    JsonType DocValue::type() const
+    {
+        if(m_node == nullptr)
+            throw ghJsonException("Bad DocValue access: node is null", 0);
+        return m_node->tag;
+    }
+    // 数字节点按存储方式转成Json，取整数时复用Json的范围检查
+    Json numberNode(const DocNode & node)
+    {
+        switch(NumberType(node.size))
         {
-            try
-            {
-                parseWhitespace(str, idx);
-                checkIndex(str, idx);
+            case NumberType::INT64:  return Json((long long)node.i);
+            case NumberType::UINT64: return Json((unsigned long long)node.u);
+            default:                 return Json(node.n);
+        }
+    }
 
-                std::string key = parseString(str, idx).getString();
+    double DocValue::getNumber() const
+    {
+        const DocNode & node = checkNode(m_node, JsonType::NUMBER, __func__);
+        switch(NumberType(node.size))
+        {
+            case NumberType::INT64:  return double(node.i);
+            case NumberType::UINT64: return double(node.u);
+            default:                 return node.n;
+        }
+    }
+    int64_t DocValue::getInt64() const { return numberNode(checkNode(m_node, JsonType::NUMBER, __func__)).getInt64(); }
+    uint64_t DocValue::getUint64() const { return numberNode(checkNode(m_node, JsonType::NUMBER, __func__)).getUint64(); }
+    bool DocValue::getBool() const { return checkNode(m_node, JsonType::BOOL, __func__).b; }
+    std::string_view DocValue::getString() const 
+    {
+        const DocNode & node = checkNode(m_node, JsonType::STRING, __func__);
+        return std::string_view(node.s, node.size);
+    }
+    size_t DocValue::size() const
+    {
+        JsonType tag = type();
+        if(tag != JsonType::ARRAY && tag != JsonType::OBJECT && tag != JsonType::STRING)
+            throw ghJsonException("Invalid type:  Attempted to call " + std::string(__func__) + " on a DocValue of type " + ToString(tag), 0);
+        return m_node->size;
+    }
 
-                parseWhitespace(str, idx);
-                checkIndex(str, idx);
-                
-                if(str[idx]!=':')
-                    throw ghJsonException("[ERROR]: object parsing, expect':', got " + str[idx], idx);
-                idx++;
-                
-                parseWhitespace(str, idx);
-                checkIndex(str, idx);
-                Json value  = parseJson(str, idx, depth);
-                out.emplace(key, value);
-            }
-            catch(const ghJsonException& ex)
-            {
-                throw ghJsonException("[ERROR]: object parse worng, " + std::string(ex.what()) , idx);
-            }
-            parseWhitespace(str, idx);
-            checkIndex(str, idx);
-            if(str[idx] == '}')
-                break;
-            if(str[idx] != ',')
-                throw ghJsonException("[ERROR]: object format worng, ", idx);
-            idx++;
+    DocValue DocValue::operator[](size_t index) const
+    {
+        const DocNode & node = checkNode(m_node, JsonType::ARRAY, __func__);
+        if(index >= node.size)
+            throw ghJsonException(std::string(__func__) + "index out of range!", 0);
+        return DocValue(&node.items[index]);
+    }
+
+    DocValue DocValue::operator[](std::string_view key) const
+    {
+        const DocNode & node = checkNode(m_node, JsonType::OBJECT, __func__);
+        for(uint32_t i = 0; i < node.size; i++)
+        {
+            const DocNode & name = node.members[i].key;
+            if(name.size == key.size() && (name.s == key.data() || memcmp(name.s, key.data(), key.size()) == 0))
+                return DocValue(&node.members[i].value);
         }
-        idx++;
-        return Json(out);
+        throw ghJsonException(std::string(__func__) + " key :[" + std::string(key) + "] not exits! ", 0);
     }
 
-    Json parseArray(const std::string & str, size_t & idx, size_t depth) 
+    DocValue DocValue::find(size_t index) const noexcept
     {
-        array out;
-        parseWhitespace(str, idx);
-        checkIndex(str, idx);
-        if(str[idx] == ']')
-            return Json(out);
+        if(m_node == nullptr || m_node->tag != JsonType::ARRAY || index >= m_node->size)
+            return DocValue();
+        return DocValue(&m_node->items[index]);
+    }
 
-        while(1)
+    DocValue DocValue::find(std::string_view key) const noexcept
+    {
+        if(m_node == nullptr || m_node->tag != JsonType::OBJECT)
+            return DocValue();
+        for(uint32_t i = 0; i < m_node->size; i++)
         {
-            try
+            const DocNode & name = m_node->members[i].key;
+            if(name.size == key.size() && (name.s == key.data() || memcmp(name.s, key.data(), key.size()) == 0))
+                return DocValue(&m_node->members[i].value);
+        }
+        return DocValue();
+    }
+
+    DocArrayIter DocValue::arrayBegin() const { return DocArrayIter(checkNode(m_node, JsonType::ARRAY, __func__).items); }
+    DocArrayIter DocValue::arrayEnd() const 
+    { 
+        const DocNode & node = checkNode(m_node, JsonType::ARRAY, __func__);
+        return DocArrayIter(node.items + node.size); 
+    }
+    DocObjectIter DocValue::objectBegin() const { return DocObjectIter(checkNode(m_node, JsonType::OBJECT, __func__).members); }
+    DocObjectIter DocValue::objectEnd() const 
+    { 
+        const DocNode & node = checkNode(m_node, JsonType::OBJECT, __func__);
+        return DocObjectIter(node.members + node.size); 
+    }
+
+    // 显式栈遍历，事件交给TreeBuilder拼树，深层文档也不递归
+    Json DocValue::toJson() const
+    {
+        struct Frame
+        {
+            bool          isArray;
+            DocArrayIter  item, itemEnd;
+            DocObjectIter member, memberEnd;
+        };
+        TreeBuilder builder;
+        std::vector<Frame> frames;
+        DocValue value = *this;
+        bool more = true;
+        while(more)
+        {
+            switch(value.type())
             {
-                Json test = parseJson(str, idx, depth);
-                out.emplace_back(std::move(test));
+                case JsonType::NUL:    builder.on_null(); break;
+                case JsonType::BOOL:   builder.on_bool(value.getBool()); break;
+                case JsonType::NUMBER: builder.on_value(numberNode(*value.m_node)); break;
+                case JsonType::STRING: builder.on_string(value.getString()); break;
+                case JsonType::ARRAY:
+                    builder.start_array();
+                    frames.push_back(Frame{true, value.arrayBegin(), value.arrayEnd(), DocObjectIter(nullptr), DocObjectIter(nullptr)});
+                    break;
+                case JsonType::OBJECT:
+                    builder.start_object();
+                    frames.push_back(Frame{false, DocArrayIter(nullptr), DocArrayIter(nullptr), value.objectBegin(), value.objectEnd()});
+                    break;
             }
-            catch(const ghJsonException& ex)
+            // 找下一个值，遍历完的容器依次闭合
+            more = false;
+            while(!frames.empty() && !more)
             {
-                throw ghJsonException("[ERROR]: array parse worng, " + std::string(ex.what()) , idx);
+                Frame & top = frames.back();
+                if(top.isArray && top.item != top.itemEnd)
+                {
+                    value = *top.item;
+                    ++top.item;
+                    more = true;
+                }
+                else if(!top.isArray && top.member != top.memberEnd)
+                {
+                    auto entry = *top.member;
+                    builder.on_key(entry.first);
+                    value = entry.second;
+                    ++top.member;
+                    more = true;
+                }
+                else
+                {
+                    top.isArray ? builder.end_array() : builder.end_object();
+                    frames.pop_back();
+                }
             }
-            parseWhitespace(str, idx);
-            checkIndex(str, idx);
-            if(str[idx] == ']')
-                break;
-            if(str[idx] != ',')
-                throw ghJsonException("[ERROR]: array format worng, ", idx);
-            idx++;
         }
-        idx++;
-        return Json(out);
+        return builder.result();
     }
-
-    Json parseString(const std::string & str, size_t & idx) 
+    //DocValue
+    //Document
+    //和TreeBuilder一样由Reader驱动，只是节点放进Document的Arena
+    class DocumentParser
     {
-        std::string out;
-        idx++;
-        while(1)
-        {
-            if(idx == str.size())
+        private:
+            Document & m_doc;
+            const std::string & m_str;
+            bool m_view;    // 不含转义的字符串直接指向输入
+            std::vector<size_t> m_bases;
+            size_t m_hits;
+            size_t m_misses;
+        public:
+            DocumentParser(Document & doc, const std::string & str, bool view) : m_doc(doc), m_str(str), m_view(view), m_hits(0), m_misses(0) {}
+            ~DocumentParser()
             {
-                throw ghJsonException("Unexpected end", idx);
+                if(m_doc.m_keys)
+                    m_doc.m_keys->addStats(m_hits, m_misses);
             }
-            if(str[idx] == '\"')
-                break;
-            else if(str[idx] == '\\')
+
+            DocNode makeString(std::string_view value)
             {
-                idx++;
-                switch(str[idx])
+                if(value.size() > UINT32_MAX)
+                    throw ghJsonException("string too long", 0);
+                DocNode node;
+                node.tag = JsonType::STRING;
+                node.size = uint32_t(value.size());
+                // Reader只有在遇到转义时才会把字符串解码到自己的缓冲里
+                if(m_view && value.data() >= m_str.data() && value.data() < m_str.data() + m_str.size())
                 {
-                    case '\"':  out+='\"'; break;
-                    case '\\':  out+='\\'; break;
-                    case '/' :  out+='/' ; break;
-                    case 'b' :  out+='\b'; break;
-                    case 'f' :  out+='\f'; break;
-                    case 'n' :  out+='\n'; break;
-                    case 'r' :  out+='\r'; break;
-                    case 't' :  out+='\t'; break;
-                    default : throw ghJsonException("unknow sequence:" + std::string(1, str[idx-1]) + std::string(1, str[idx]), idx);
+                    node.s = value.data();
+                    return node;
                 }
+                char * data = m_doc.m_arena.allocate<char>(value.size() + 1);
+                memcpy(data, value.data(), value.size());
+                data[value.size()] = '\0';
+                node.s = data;
+                return node;
             }
-            else
+
+            void push(JsonType tag)
             {
-                out+=str[idx];
+                DocNode node;
+                node.tag = tag;
+                node.size = 0;
+                node.n = 0;
+                m_doc.m_stack.push_back(node);
             }
-            idx++;
-        }
-        idx++;
-        return Json(out);
+
+            bool on_null() { push(JsonType::NUL); return true; }
+            bool on_bool(bool value)
+            {
+                push(JsonType::BOOL);
+                m_doc.m_stack.back().b = value;
+                return true;
+            }
+            bool on_number(double value)
+            {
+                push(JsonType::NUMBER);
+                m_doc.m_stack.back().n = value;
+                return true;
+            }
+            bool on_int64(int64_t value)
+            {
+                push(JsonType::NUMBER);
+                m_doc.m_stack.back().size = uint32_t(NumberType::INT64);
+                m_doc.m_stack.back().i = value;
+                return true;
+            }
+            bool on_uint64(uint64_t value)
+            {
+                push(JsonType::NUMBER);
+                m_doc.m_stack.back().size = uint32_t(NumberType::UINT64);
+                m_doc.m_stack.back().u = value;
+                return true;
+            }
+            // Document不开raw_numbers，不会收到这个事件
+            bool on_raw_number(std::string_view text) { return on_number(rawToDouble(text)); }
+            bool on_string(std::string_view value) { m_doc.m_stack.push_back(makeString(value)); return true; }
+            bool on_key(std::string_view key)
+            {
+                std::string_view interned = m_doc.m_keys ? m_doc.m_keys->intern(key, m_hits, m_misses) : std::string_view();
+                if(interned.data() == nullptr)
+                {
+                    m_doc.m_stack.push_back(makeString(key));
+                    return true;
+                }
+                DocNode node;
+                node.tag = JsonType::STRING;
+                node.size = uint32_t(interned.size());
+                node.s = interned.data();
+                m_doc.m_stack.push_back(node);
+                return true;
+            }
+            bool start_array() { m_bases.push_back(m_doc.m_stack.size()); return true; }
+            bool start_object() { m_bases.push_back(m_doc.m_stack.size()); return true; }
+
+            // 子节点先压到m_stack上，结束时一次性拷进Arena
+            template<typename T>
+            const T * commit(size_t base, size_t count)
+            {
+                std::vector<DocNode> & stack = m_doc.m_stack;
+                if(count == 0)
+                    return nullptr;
+                T * out = m_doc.m_arena.allocate<T>(count);
+                memcpy(static_cast<void *>(out), stack.data() + base, sizeof(T) * count);
+                stack.resize(base);
+                return out;
+            }
+
+            bool end_array()
+            {
+                size_t base = m_bases.back();
+                m_bases.pop_back();
+                size_t count = m_doc.m_stack.size() - base;
+                if(count > UINT32_MAX)
+                    throw ghJsonException("array too large", 0);
+                DocNode node;
+                node.tag = JsonType::ARRAY;
+                node.size = uint32_t(count);
+                node.items = commit<DocNode>(base, count);
+                m_doc.m_stack.push_back(node);
+                return true;
+            }
+
+            bool end_object()
+            {
+                size_t base = m_bases.back();
+                m_bases.pop_back();
+                size_t count = (m_doc.m_stack.size() - base) / 2;
+                if(count > UINT32_MAX)
+                    throw ghJsonException("object too large", 0);
+                DocNode node;
+                node.tag = JsonType::OBJECT;
+                node.size = uint32_t(count);
+                node.members = commit<DocMember>(base, count);
+                m_doc.m_stack.push_back(node);
+                return true;
+            }
+    };
+
+    Document::Document() noexcept : m_keys(nullptr)
+    {
+        m_root.tag = JsonType::NUL;
+        m_root.size = 0;
+        m_root.n = 0;
     }
 
-    Json parseNumber(const std::string &str, size_t &idx) 
+    void Document::parse(const std::string & in, bool view)
     {
-        size_t processed = 0;
-        double value = 0.0;
+        m_arena.clear();
+        m_stack.clear();
+        m_root.tag = JsonType::NUL;
+        m_root.size = 0;
+        DocumentParser builder(*this, in, view);
+        Reader<DocumentParser> reader(in, builder);
+        reader.parseValue(0);
+        m_root = m_stack.back();
+        m_stack.clear();
+    }
 
-        try
-        {
-            value = std::stod(str.substr(idx), &processed);
-        }
-        catch (const std::invalid_argument&)
-        {
-            throw ghJsonException("Invalid number format", idx);
-        }
-        catch (const std::out_of_range&)
-        {
-            throw ghJsonException("Number out of range", idx);
-        }
+    void Document::parse(const std::string & in) { parse(in, false); }
+    void Document::parseView(const std::string & in) { parse(in, true); }
 
-        // If we get here, processed must be more than 0, since otherwise
-        // an exception would have been thrown.
-        idx += processed;
-        return Json(value);
+    Document parseDocument(const std::string & in)
+    {
+        Document doc;
+        doc.parse(in);
+        return doc;
     }
 
-    Json parseLiteral(const std::string &literal, Json target, const std::string & str, size_t & idx) 
+    Document parseView(const std::string & in)
+    {
+        Document doc;
+        doc.parseView(in);
+        return doc;
+    }
+    //Document
+    //JsonPath
+    // 按RFC 6901拆分并解码引用记号
+    std::vector<std::string> decodePointer(std::string_view pointer)
     {
-        if(str.compare(idx, literal.length(), literal) == 0)
+        std::vector<std::string> tokens;
+        if(pointer.empty())
+            return tokens;
+        if(pointer[0] != '/')
+            throw ghJsonException("JsonPath: pointer must be empty or start with '/'", 0);
+        size_t idx = 1;
+        while(1)
         {
-            idx += literal.length();
-            return target;
+            std::string token;
+            while(idx < pointer.size() && pointer[idx] != '/')
+            {
+                char c = pointer[idx];
+                if(c == '~')
+                {
+                    char next = idx + 1 < pointer.size() ? pointer[idx + 1] : '\0';
+                    if(next != '0' && next != '1')
+                        throw ghJsonException("JsonPath: '~' must be followed by '0' or '1'", idx);
+                    c = next == '0' ? '~' : '/';
+                    idx++;
+                }
+                token += c;
+                idx++;
+            }
+            tokens.push_back(std::move(token));
+            if(idx == pointer.size())
+                break;
+            idx++;
         }
-        else
-            throw ghJsonException("[ERROR]:expected (" + literal + "), got (" + str.substr(idx, literal.length()) + ")", idx);
+        return tokens;
     }
 
-    Json parseJson(const std::string & str, size_t & idx, size_t depth)
+    JsonPath::JsonPath(std::string_view pointer) : m_pointer(pointer)
     {
-        if(depth > MAXDEPTH)
+        for(std::string & key : decodePointer(pointer))
         {
-            throw ghJsonException("exceeded maximum nesting depth", 0);
+            // 数组下标: 0或者不以0开头的十进制数，"-"(末尾之后)在查找时总是不存在
+            size_t index = SIZE_MAX;
+            if(!key.empty() && key.size() <= 19 && (key.size() == 1 || key[0] != '0')
+               && std::all_of(key.begin(), key.end(), [](char ch) { return ch >= '0' && ch <= '9'; }))
+                index = std::stoull(key);
+            m_tokens.push_back(Token{std::move(key), index});
         }
-        parseWhitespace(str, idx);
-        checkIndex(str, idx);
+    }
 
-        if(str[idx] == 'n')
-        {
-            return parseLiteral("null", Json(), str, idx);
-        }
-        else if(str[idx] == 't')
-        {
-            return parseLiteral("true", Json(true), str, idx);
-        }
-        else if(str[idx] == 'f')
-        {
-            return parseLiteral("false", Json(false), str, idx);
-        }
-        else if(str[idx] == '\"')
-        {
-            return parseString(str, idx);
-        }
-        else if(str[idx] == '[')
+    const Json * JsonPath::find(const Json & root) const noexcept
+    {
+        const Json * current = &root;
+        for(const Token & token : m_tokens)
         {
-            return parseArray(str, ++idx, ++depth);
+            current = current->is_array() ? current->find(token.index) : current->find(token.key);
+            if(current == nullptr)
+                return nullptr;
         }
-        else if(str[idx] == '{')
+        return current;
+    }
+
+    DocValue JsonPath::find(const DocValue & root) const noexcept
+    {
+        DocValue current = root;
+        for(const Token & token : m_tokens)
         {
-            return parseObject(str, ++idx, ++depth);
+            if(!current)
+                break;
+            current = current.is_array() ? current.find(token.index) : current.find(token.key);
         }
-        else
+        return current;
+    }
+
+    LazyValue JsonPath::find(const LazyValue & root) const
+    {
+        LazyValue current = root;
+        for(const Token & token : m_tokens)
         {
-            return parseNumber(str, idx);
+            if(!current)
+                break;
+            current = current.is_array() ? current.find(token.index) : current.find(token.key);
         }
+        return current;
     }
-    
-    Json parse(const std::string & in)
+    //JsonPath
+    //projection
+    const Projection::Node * Projection::Node::find(std::string_view name) const
     {
-        size_t idx = 0;
-        size_t depth = 0;
-        return parseJson(in, idx, depth);
+        auto iter = std::lower_bound(children.begin(), children.end(), name, [](const Node & node, std::string_view key) { return node.key < key; });
+        return iter != children.end() && iter->key == name ? &*iter : nullptr;
     }
-    //parse
-}
\ No newline at end of file
+
+    Projection::Projection(std::initializer_list<std::string_view> pointers)
+    {
+        for(std::string_view pointer : pointers)
+            add(pointer);
+    }
+
+    Projection & Projection::add(std::string_view pointer)
+    {
+        Node * node = &m_root;
+        for(std::string & key : decodePointer(pointer))
+        {
+            if(node->all)
+                return *this;
+            auto iter = std::lower_bound(node->children.begin(), node->children.end(), key, [](const Node & child, const std::string & name) { return child.key < name; });
+            if(iter == node->children.end() || iter->key != key)
+            {
+                Node child;
+                child.key = std::move(key);
+                iter = node->children.insert(iter, std::move(child));
+            }
+            node = &*iter;
+        }
+        // 更短的路径覆盖更长的
+        node->all = true;
+        node->children.clear();
+        return *this;
+    }
+    //projection
+}
@@ -5,17 +5,359 @@
 #include <vector>
 #include <memory>
 #include <stdexcept>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <iosfwd>
+#include <initializer_list>
+#include <utility>
+#include <atomic>
+#include <memory_resource>
 
-#define MAXDEPTH 10
+//object的存储方式，编译时用 -DGHJSON_OBJECT_BACKEND=GHJSON_OBJECT_xxx 选择，库和使用方必须一致
+#define GHJSON_OBJECT_MAP     0 // std::map，按key排序
+#define GHJSON_OBJECT_FLAT    1 // 有序vector，按key排序，适合小对象
+#define GHJSON_OBJECT_HASH    2 // 开放寻址哈希，迭代顺序不保证，适合大对象
+#define GHJSON_OBJECT_ORDERED 3 // 开放寻址哈希，按插入顺序迭代(字段顺序和输入一致)
+#ifndef GHJSON_OBJECT_BACKEND
+#define GHJSON_OBJECT_BACKEND GHJSON_OBJECT_MAP
+#endif
 
 namespace ghjson
 {
 
     class Json;
-    class JsonValue;
+    class Sink;
+    class Projection;
+
+    struct DumpOptions
+    {
+        bool   pretty = false;  // 默认不输出任何空白，适合网络传输
+        size_t indent = 4;      // pretty时每层缩进的空格数
+    };
     
-    using array = std::vector<Json>;
-    using object = std::map<std::string, Json>;
+    //object
+    //传给FlatMap的元素已经按key排好序且没有重复
+    struct sorted_unique_t { explicit sorted_unique_t() = default; };
+    inline constexpr sorted_unique_t sorted_unique{};
+
+    //按key排序的vector: 查找二分，插入/删除要移动后面的元素，适合字段不多的对象
+    template<typename V>
+    class FlatMap
+    {
+        public:
+            using key_type = std::string;
+            using mapped_type = V;
+            using value_type = std::pair<std::string, V>;
+            using size_type = size_t;
+            using container_type = std::pmr::vector<value_type>;
+            using allocator_type = typename container_type::allocator_type;
+            using iterator = typename container_type::iterator;
+            using const_iterator = typename container_type::const_iterator;
+
+            FlatMap() = default;
+            explicit FlatMap(const allocator_type & alloc) : m_items(alloc) {}
+            FlatMap(const FlatMap & other, const allocator_type & alloc) : m_items(other.m_items, alloc) {}
+            FlatMap(std::initializer_list<value_type> items) { for(const auto & item : items) emplace(item.first, item.second); }
+            FlatMap(sorted_unique_t, container_type && items) : m_items(std::move(items)) {}
+
+            allocator_type get_allocator() const { return m_items.get_allocator(); }
+
+            iterator begin() { return m_items.begin(); }
+            iterator end()   { return m_items.end();   }
+            const_iterator begin()  const { return m_items.begin(); }
+            const_iterator end()    const { return m_items.end();   }
+            const_iterator cbegin() const { return m_items.cbegin(); }
+            const_iterator cend()   const { return m_items.cend();   }
+            size_t size()  const { return m_items.size();  }
+            bool   empty() const { return m_items.empty(); }
+            void   clear()       { m_items.clear(); }
+            void   reserve(size_t n) { m_items.reserve(n); }
+
+            iterator lower_bound(const std::string & key) { return m_items.begin() + lowerBound(key); }
+            const_iterator lower_bound(const std::string & key) const { return m_items.begin() + lowerBound(key); }
+            iterator find(const std::string & key)
+            {
+                size_t idx = lowerBound(key);
+                return idx < m_items.size() && m_items[idx].first == key ? m_items.begin() + idx : m_items.end();
+            }
+            const_iterator find(const std::string & key) const { return const_cast<FlatMap *>(this)->find(key); }
+            size_t count(const std::string & key) const { return find(key) != end(); }
+
+            //和std::map一样，key已存在时不覆盖
+            template<typename K, typename M>
+            std::pair<iterator, bool> emplace(K && key, M && value)
+            {
+                std::string k(std::forward<K>(key));
+                size_t idx = lowerBound(k);
+                if(idx < m_items.size() && m_items[idx].first == k)
+                    return {m_items.begin() + idx, false};
+                return {m_items.emplace(m_items.begin() + idx, std::move(k), std::forward<M>(value)), true};
+            }
+            std::pair<iterator, bool> insert(const value_type & item) { return emplace(item.first, item.second); }
+            V & operator[](const std::string & key) { return emplace(key, V()).first->second; }
+
+            iterator erase(const_iterator pos) { return m_items.erase(pos); }
+            size_t erase(const std::string & key)
+            {
+                auto iter = find(key);
+                if(iter == m_items.end())
+                    return 0;
+                m_items.erase(iter);
+                return 1;
+            }
+
+            friend bool operator==(const FlatMap & lhs, const FlatMap & rhs) { return lhs.m_items == rhs.m_items; }
+            friend bool operator!=(const FlatMap & lhs, const FlatMap & rhs) { return !(lhs == rhs); }
+            friend bool operator< (const FlatMap & lhs, const FlatMap & rhs) { return lhs.m_items < rhs.m_items; }
+        private:
+            container_type m_items;
+            friend class ObjectBuilder;     // 解析时直接复用m_items的容量
+
+            size_t lowerBound(const std::string & key) const
+            {
+                size_t first = 0, n = m_items.size();
+                while(n > 0)
+                {
+                    size_t half = n / 2;
+                    if(m_items[first + half].first < key)
+                    {
+                        first += half + 1;
+                        n -= half + 1;
+                    }
+                    else
+                        n = half;
+                }
+                return first;
+            }
+    };
+
+    //元素连续存放在vector里，另有一张线性探测的索引表指向它们(小对象不建索引，直接顺序查找)
+    //Ordered为true时删除会保持其余元素的插入顺序，否则把最后一个元素挪到空位上
+    //注意: 迭代器可以修改value，但不要修改key
+    template<typename V, bool Ordered = false>
+    class HashMap
+    {
+        public:
+            using key_type = std::string;
+            using mapped_type = V;
+            using value_type = std::pair<std::string, V>;
+            using size_type = size_t;
+            using allocator_type = std::pmr::polymorphic_allocator<value_type>;
+            using iterator = typename std::pmr::vector<value_type>::iterator;
+            using const_iterator = typename std::pmr::vector<value_type>::const_iterator;
+
+            HashMap() = default;
+            explicit HashMap(const allocator_type & alloc) : m_items(alloc), m_slots(alloc) {}
+            HashMap(const HashMap & other, const allocator_type & alloc) : m_items(other.m_items, alloc), m_slots(other.m_slots, alloc) {}
+            HashMap(std::initializer_list<value_type> items) { for(const auto & item : items) emplace(item.first, item.second); }
+
+            allocator_type get_allocator() const { return m_items.get_allocator(); }
+
+            iterator begin() { return m_items.begin(); }
+            iterator end()   { return m_items.end();   }
+            const_iterator begin()  const { return m_items.begin(); }
+            const_iterator end()    const { return m_items.end();   }
+            const_iterator cbegin() const { return m_items.cbegin(); }
+            const_iterator cend()   const { return m_items.cend();   }
+            size_t size()  const { return m_items.size();  }
+            bool   empty() const { return m_items.empty(); }
+            void   clear()       { m_items.clear(); m_slots.clear(); }
+            void   reserve(size_t n)
+            {
+                m_items.reserve(n);
+                if(n > kLinear && n * 2 > m_slots.size())
+                    rehash(n);
+            }
+
+            iterator find(const std::string & key)
+            {
+                size_t idx = locate(key, hash(key));
+                return idx == npos ? m_items.end() : m_items.begin() + idx;
+            }
+            const_iterator find(const std::string & key) const { return const_cast<HashMap *>(this)->find(key); }
+            size_t count(const std::string & key) const { return find(key) != end(); }
+
+            //和std::map一样，key已存在时不覆盖
+            template<typename K, typename M>
+            std::pair<iterator, bool> emplace(K && key, M && value)
+            {
+                std::string k(std::forward<K>(key));
+                uint32_t h = hash(k);
+                size_t idx = locate(k, h);
+                if(idx != npos)
+                    return {m_items.begin() + idx, false};
+                m_items.emplace_back(std::move(k), std::forward<M>(value));
+                if(!m_slots.empty() && m_items.size() * 2 <= m_slots.size())
+                    place(h, m_items.size() - 1);
+                else if(m_items.size() > kLinear)
+                    rehash(m_items.size());
+                return {m_items.end() - 1, true};
+            }
+            std::pair<iterator, bool> insert(const value_type & item) { return emplace(item.first, item.second); }
+            V & operator[](const std::string & key) { return emplace(key, V()).first->second; }
+
+            iterator erase(const_iterator pos)
+            {
+                size_t idx = pos - m_items.cbegin();
+                eraseAt(idx);
+                return m_items.begin() + idx;
+            }
+            size_t erase(const std::string & key)
+            {
+                size_t idx = locate(key, hash(key));
+                if(idx == npos)
+                    return 0;
+                eraseAt(idx);
+                return 1;
+            }
+
+            //和顺序无关: 键值对的集合相同就相等
+            friend bool operator==(const HashMap & lhs, const HashMap & rhs)
+            {
+                if(lhs.size() != rhs.size())
+                    return false;
+                for(const auto & item : lhs)
+                {
+                    auto iter = rhs.find(item.first);
+                    if(iter == rhs.end() || !(iter->second == item.second))
+                        return false;
+                }
+                return true;
+            }
+            friend bool operator!=(const HashMap & lhs, const HashMap & rhs) { return !(lhs == rhs); }
+        private:
+            static constexpr size_t kLinear = 8;
+            static constexpr size_t npos = size_t(-1);
+
+            std::pmr::vector<value_type> m_items;
+            std::pmr::vector<uint64_t>   m_slots; // 高32位是hash，低32位是下标+1，0表示空槽
+            friend class ObjectBuilder;
+
+            static uint32_t hash(const std::string & key) { return uint32_t(std::hash<std::string_view>()(key)); }
+            size_t mask() const { return m_slots.size() - 1; }
+
+            size_t locate(const std::string & key, uint32_t h) const
+            {
+                if(m_slots.empty())
+                {
+                    for(size_t i = 0; i < m_items.size(); i++)
+                        if(m_items[i].first == key)
+                            return i;
+                    return npos;
+                }
+                for(size_t i = h & mask(); m_slots[i]; i = (i + 1) & mask())
+                {
+                    size_t idx = uint32_t(m_slots[i]) - 1;
+                    if(uint32_t(m_slots[i] >> 32) == h && m_items[idx].first == key)
+                        return idx;
+                }
+                return npos;
+            }
+
+            void place(uint32_t h, size_t idx)
+            {
+                size_t i = h & mask();
+                while(m_slots[i])
+                    i = (i + 1) & mask();
+                m_slots[i] = uint64_t(h) << 32 | (idx + 1);
+            }
+
+            //槽数保持2的幂且至少是元素数的两倍
+            void rehash(size_t n)
+            {
+                size_t capacity = 16;
+                while(capacity < n * 2)
+                    capacity *= 2;
+                m_slots.assign(capacity, 0);
+                for(size_t i = 0; i < m_items.size(); i++)
+                    place(hash(m_items[i].first), i);
+            }
+
+            size_t slotOf(size_t idx) const
+            {
+                size_t i = hash(m_items[idx].first) & mask();
+                while(uint32_t(m_slots[i]) != idx + 1)
+                    i = (i + 1) & mask();
+                return i;
+            }
+
+            //线性探测的删除: 把后面本该在空槽之前的元素往前挪，不留墓碑
+            void clearSlot(size_t i)
+            {
+                size_t j = i;
+                while(1)
+                {
+                    m_slots[i] = 0;
+                    while(1)
+                    {
+                        j = (j + 1) & mask();
+                        if(!m_slots[j])
+                            return;
+                        size_t home = uint32_t(m_slots[j] >> 32) & mask();
+                        if(i <= j ? (i < home && home <= j) : (i < home || home <= j))
+                            continue;
+                        m_slots[i] = m_slots[j];
+                        i = j;
+                        break;
+                    }
+                }
+            }
+
+            void eraseAt(size_t idx)
+            {
+                size_t last = m_items.size() - 1;
+                if(!m_slots.empty())
+                {
+                    clearSlot(slotOf(idx));
+                    if(Ordered)
+                    {
+                        for(auto & slot : m_slots)
+                            if(uint32_t(slot) > idx + 1)
+                                slot--;
+                    }
+                    else if(idx != last)
+                    {
+                        uint64_t & slot = m_slots[slotOf(last)];
+                        slot = (slot >> 32) << 32 | (idx + 1);
+                    }
+                }
+                if(Ordered)
+                    m_items.erase(m_items.begin() + idx);
+                else
+                {
+                    if(idx != last)
+                        m_items[idx] = std::move(m_items[last]);
+                    m_items.pop_back();
+                }
+            }
+    };
+
+    template<typename V>
+    using OrderedMap = HashMap<V, true>;
+
+    //array的元素和object的节点通过std::pmr::memory_resource分配，默认是std::pmr::get_default_resource()
+    //键和字符串值仍然是std::string，超过内联缓冲的内容在全局堆上，不经过这个资源
+    //和std::pmr容器一样: 拷贝构造回到默认资源，带allocator的构造和移动构造留在指定的资源里
+    class array : public std::pmr::vector<Json>
+    {
+        public:
+            using std::pmr::vector<Json>::vector;
+            array() = default;
+            //兼容原来的std::vector<Json>，元素逐个拷贝/移动到默认资源
+            array(const std::vector<Json> & values);
+            array(std::vector<Json> && values);
+    };
+#if GHJSON_OBJECT_BACKEND == GHJSON_OBJECT_FLAT
+    using object = FlatMap<Json>;
+#elif GHJSON_OBJECT_BACKEND == GHJSON_OBJECT_HASH
+    using object = HashMap<Json>;
+#elif GHJSON_OBJECT_BACKEND == GHJSON_OBJECT_ORDERED
+    using object = OrderedMap<Json>;
+#else
+    using object = std::pmr::map<std::string, Json>;
+#endif
     using arrayiter = array::iterator;
     using const_arrayiter = array::const_iterator;
     using objectiter = object::iterator;
@@ -30,85 +372,72 @@ namespace ghjson
             size_t pos;
     };
 
-    enum class JsonType
+    enum class JsonType : uint8_t
     {
         NUL, NUMBER, BOOL, STRING, ARRAY, OBJECT
     };
 
-    //JsonValue
-    class JsonValue
+    //数字的存储方式，type()对所有数字都返回NUMBER
+    //解析时没有小数点和指数、能放进int64的整数存成INT64，只有超过INT64_MAX的非负整数才是UINT64
+    enum class NumberType : uint8_t
     {
-        public:
-            //type
-            virtual JsonType type() const = 0;
-            //type
-            //comparisons
-            virtual bool equals(const JsonValue * other) const = 0;
-            virtual bool less(const JsonValue * other) const  = 0;
-            //comparisons
-            //getvalue
-            virtual double              getNumber() const = 0;
-            virtual bool                getBool  () const = 0;
-            virtual const std::string & getString() const = 0;
-            virtual const array &       getArray () const = 0;
-            virtual const object &      getObject() const = 0;
-            //getvalue
-            //operator[]
-            virtual Json& operator[](size_t index)  = 0;
-            virtual Json& operator[](const std::string& key)  = 0;
-            virtual const Json& operator[](size_t index) const   = 0;
-            virtual const Json& operator[](const std::string& key) const  = 0;
-            //operator[]
-            //setvalue
-            virtual void setNumber (double               value)  = 0;
-            virtual void setBool   (bool                 value)  = 0;
-            virtual void setString (const  std::string & value)  = 0;
-            virtual void setArray  (const  array       & value)  = 0;
-            virtual void setObject (const  object      & value)  = 0;
-
-            virtual void addToArray (const Json & value)  = 0;
-            virtual void addToObject(const std::string & key, const Json & value)  = 0;
-
-            virtual void removeFromArray(size_t index)  = 0;
-            virtual void removeFromObject(const std::string& key)  = 0;
-            //setvalue
-            //clone
-            virtual std::unique_ptr<JsonValue> clone() const = 0;
-            //clone
-            //dump
-            virtual void dump(std::string & str, size_t depth) const = 0;
-            //dump
-            //iterator
-            virtual arrayiter arrayBegin() = 0;
-            virtual const_arrayiter arrayBegin_const() const = 0;
-            virtual arrayiter arrayEnd() = 0;
-            virtual const_arrayiter arrayEnd_const() const = 0;
-            virtual objectiter objectBegin() = 0;
-            virtual const_objectiter objectBegin_const() const = 0;
-            virtual objectiter objectEnd() = 0;
-            virtual const_objectiter objectEnd_const() const = 0;
-            //iterator
-            virtual ~JsonValue() noexcept {} ;
+        DOUBLE, INT64, UINT64,
+        RAW     // ParseOptions::raw_numbers时保留原文，不能精确表示成整数的数字不经过double
     };
 
+    //Json
+    template<typename T>
+    struct Shared; // 带引用计数的堆节点
+
+    //tagged union: null/bool/number 直接存在Json里，string/array/object 才指向堆上
+    //拷贝只增加引用计数(copy-on-write)，set*/addTo*/removeFrom*/非const的operator[]和迭代器
+    //会在修改前把被共享的节点复制一份，所以只有被修改的那条路径会被拷贝。
+    //多个线程可以同时读取、拷贝共享同一节点的不同Json对象；同一个Json对象的并发修改需要调用方加锁。
+    //注意: 通过非const接口拿到的引用/迭代器在该Json被拷贝后不要再用来修改。
+    //堆节点从std::pmr::memory_resource分配，array/object节点和它们的元素用同一个资源，修改前的复制也留在原资源里。
+    //只有节点和容器的存储走资源: 字符串内容和对象的键是普通std::string，长的仍然从全局堆分配。
+    //拷贝Json只增加引用计数，所以资源(比如monotonic_buffer_resource)必须比所有指向它的Json活得久。
     class Json
     {
         private:
-            std::unique_ptr<JsonValue> m_ptr;
+            JsonType   m_type;
+            NumberType m_numberType = NumberType::DOUBLE;  // 只对NUMBER有意义
+            union
+            {
+                bool                  m_bool;
+                double                m_number;
+                int64_t               m_int;
+                uint64_t              m_uint;
+                Shared<std::string> * m_string;  // STRING，以及RAW数字的原文
+                Shared<array> *       m_array;
+                Shared<object> *      m_object;
+            };
+            void destroy() noexcept;
+            friend class NodePool;
+            friend class JsonCompare;
         public:
             //constructor
             Json() noexcept;                // NUL
             Json(std::nullptr_t) noexcept;  // NUL
-            Json(int value);             // NUMBER
-            Json(double value);             // NUMBER
-            Json(bool value);               // BOOL
+            Json(int value) noexcept;       // NUMBER(INT64)
+            Json(long value) noexcept;
+            Json(long long value) noexcept;
+            Json(unsigned value) noexcept;  // NUMBER(不超过INT64_MAX时是INT64，否则是UINT64)
+            Json(unsigned long value) noexcept;
+            Json(unsigned long long value) noexcept;
+            Json(double value) noexcept;    // NUMBER(DOUBLE)
+            Json(bool value) noexcept;      // BOOL
             Json(const std::string &value); // STRING
             Json(std::string &&value);      // STRING
             Json(const char * value);       // STRING
-            Json(const array &values);      // ARRAY
+            Json(const array &values);      // ARRAY，节点和拷贝的元素都在values.get_allocator()的资源里
             Json(array &&values);           // ARRAY
-            Json(const object &values);     // OBJECT
+            Json(const object &values);     // OBJECT，同上
             Json(object &&values);          // OBJECT
+            //STRING，节点从resource分配(nullptr表示默认资源)；超过std::string内联缓冲的内容仍然在全局堆上
+            Json(std::string value, std::pmr::memory_resource * resource);
+            //NUMBER(RAW): text必须是一个完整的JSON数字，否则抛出ghJsonException
+            static Json rawNumber(std::string_view text, std::pmr::memory_resource * resource = nullptr);
 
             Json(const Json & other);
             Json(Json && other) noexcept;
@@ -116,19 +445,24 @@ namespace ghjson
             Json& operator=(const Json& other) ;
             Json& operator=(Json && other) noexcept;
             
-            ~Json() noexcept {};
+            ~Json() noexcept { destroy(); }
             //constructor
             //type
-            JsonType type() const;
-            bool is_null()   const;
-            bool is_number() const;
-            bool is_bool()   const;
-            bool is_string() const;
-            bool is_array()  const;
-            bool is_object() const;
+            JsonType type() const { return m_type; }
+            bool is_null()   const { return m_type == JsonType::NUL;    }
+            bool is_number() const { return m_type == JsonType::NUMBER; }
+            bool is_bool()   const { return m_type == JsonType::BOOL;   }
+            bool is_string() const { return m_type == JsonType::STRING; }
+            bool is_array()  const { return m_type == JsonType::ARRAY;  }
+            bool is_object() const { return m_type == JsonType::OBJECT; }
             //type
             //getValue
-            double              getNumber() const;
+            double              getNumber() const;     // 任何存储方式都转成double
+            //整数不能精确表示成int64/uint64时(带小数、超出范围)抛出ghJsonException
+            int64_t             getInt64()  const;
+            uint64_t            getUint64() const;
+            NumberType          numberType() const;
+            std::string_view    getRawNumber() const;  // 只对RAW数字可用
             bool                getBool()   const;
             const std::string & getString() const;
             const array &       getArray()  const;
@@ -140,8 +474,14 @@ namespace ghjson
             const Json & operator[](size_t index) const ; 
             const Json & operator[](const std::string &key) const;
             //operator[]
+            //find: 和const的operator[]一样，但类型不对或不存在时返回nullptr，不抛异常
+            const Json * find(size_t index) const noexcept;
+            const Json * find(const std::string &key) const noexcept;
+            //find
             //setValue
             void setNumber (double               value);
+            void setInt64  (int64_t              value);
+            void setUint64 (uint64_t             value);
             void setBool   (bool                 value);
             void setString (const  std::string & value);
             void setArray  (const  array       & value);
@@ -162,18 +502,14 @@ namespace ghjson
             bool operator>= (const Json &rhs) const { return !(*this < rhs); }  
             //comparisons
             //dump
-            void dump(std::string & str, size_t depth) const;
-            const std::string dump() const;
+            void dump(std::string & str, const DumpOptions & options = DumpOptions()) const;    // 追加到str
+            const std::string dump(const DumpOptions & options = DumpOptions()) const;
+            //边序列化边输出，只占用固定大小的缓冲
+            void dumpTo(Sink & sink, const DumpOptions & options = DumpOptions()) const;
+            void dumpTo(int fd, const DumpOptions & options = DumpOptions()) const;
+            void dumpTo(std::FILE * file, const DumpOptions & options = DumpOptions()) const;
+            void dumpTo(std::ostream & os, const DumpOptions & options = DumpOptions()) const;
             //dump
-            //check
-            inline void check() const
-            {
-                if(!m_ptr)
-                {
-                    throw ghJsonException("Bad Json access: m_ptr is null", 0);
-                } 
-            }
-            //check
             //iterator
             arrayiter arrayBegin();
             const_arrayiter arrayBegin_const() const ;
@@ -185,8 +521,589 @@ namespace ghjson
             const_objectiter objectEnd_const() const ;
             //iterator
     };
+    static_assert(sizeof(Json) == 16, "Json should stay 16 bytes");
+    //Json
+
+    struct ParseOptions
+    {
+        //允许的最大嵌套层数；解析、序列化和析构都不递归，调大不会爆栈
+        //不接受ParseOptions的接口(parseSax、Document、parseNdjson等)使用默认值
+        size_t max_depth = 1024;
+        //两阶段解析: 先用SIMD扫出所有结构字符的位置，再按位置建树
+        bool structural_index = false;
+        //只保留projection里列出的字段(见Projection)，设置后不使用structural_index
+        const Projection * projection = nullptr;
+        //不能精确表示成int64/uint64的数字保留原文(NumberType::RAW)，dump时原样输出，不会丢精度
+        bool raw_numbers = false;
+        //结果里的节点、数组和对象的存储从这里分配，nullptr表示std::pmr::get_default_resource()
+        //字符串和键不从这里分配: 它们仍然是std::string，超过内联缓冲的内容在全局堆上；资源要比结果活得久
+        std::pmr::memory_resource * resource = nullptr;
+    };
 
     Json parse(const std::string & in);
+    Json parse(const std::string & in, const ParseOptions & options);
+
+    //error code
+    enum class ParseErrc : uint8_t
+    {
+        NONE,
+        UNEXPECTED_END,         // 值还没结束输入就没了
+        INVALID_LITERAL,        // null/true/false拼写错误
+        INVALID_NUMBER,
+        NUMBER_OUT_OF_RANGE,
+        INVALID_ESCAPE,         // 未知的转义字符
+        INVALID_UNICODE,        // \u后面不是4位十六进制
+        INVALID_SURROGATE,      // 代理项不成对
+        EXPECTED_KEY,
+        EXPECTED_COLON,
+        EXPECTED_ARRAY_COMMA,   // 数组元素后面不是 , 或 ]
+        EXPECTED_OBJECT_COMMA,  // 对象成员后面不是 , 或 }
+        UNEXPECTED_CHARACTER,   // 只在structural_index时出现: 值的位置上是结构字符，或标量后面跟了别的字符
+        DEPTH_EXCEEDED,
+        OUT_OF_MEMORY,
+    };
+
+    struct ParseError
+    {
+        ParseErrc code = ParseErrc::NONE;
+        size_t offset = 0;      // 出错位置的字节偏移
+        size_t line = 0;        // 从1开始
+        size_t column = 0;      // 从1开始，按字节计
+        explicit operator bool() const { return code != ParseErrc::NONE; }
+    };
+
+    //不抛异常的parse: 成功时写入out并返回true；失败时返回false，out不变，err给出错误码和位置
+    //出错路径不分配内存、不展开栈，适合大量拒绝不合法输入的场景
+    bool parse(const std::string & in, Json & out, ParseError & err, const ParseOptions & options = ParseOptions()) noexcept;
+    //error code
+
+    //reusable parser
+    //反复解析相似的文档时复用同一个Parser: 读取器、建树用的缓冲和结构索引都留到下一次。
+    //用完的结果交给recycle(parse(in, out, err)成功时out原来的值也会交回)，其中只被这一份引用的
+    //字符串、数组、对象拆开缓存，下一次建树时优先取用并保留原来的容量，稳定之后每个文档几乎不再分配内存
+    //缓存只增不减，需要时调用shrink()。options里的projection要比Parser活得久；Parser不是线程安全的
+    //设置了options.resource时缓存的节点也从它分配，资源要比Parser和所有结果活得久；别的资源里的节点不缓存
+    class ParserState;
+    class Parser
+    {
+        public:
+            explicit Parser(const ParseOptions & options = ParseOptions());
+            Parser(const Parser &) = delete;
+            Parser& operator=(const Parser &) = delete;
+            Parser(Parser &&) noexcept;
+            Parser& operator=(Parser &&) noexcept;
+            ~Parser();
+
+            Json parse(const std::string & in);     // 出错时抛出和ghjson::parse相同的ghJsonException
+            //不抛异常: 成功时写入out并回收out原来的值；失败时out不变
+            bool parse(const std::string & in, Json & out, ParseError & err) noexcept;
+            void recycle(Json && json) noexcept;
+            void shrink() noexcept;                 // 释放缓存的节点和缓冲
+
+            //Parser在自己的分配点上记下的次数: 缓存里没有可用的节点时新建，节点或缓冲的容量不够时扩容，各记一次
+            //这是统计不是测量: 同一次调用里一个缓冲扩容多次只记一次，所以会偏少；只适合看是否已经稳定
+            //要实际的分配次数请替换全局operator new计数，或者给options.resource传一个计数的资源
+            size_t allocations() const;
+            size_t cachedNodes() const;             // 当前缓存着的节点数
+        private:
+            std::unique_ptr<ParserState> m_state;
+    };
+    //reusable parser
+
+    //file
+    //普通文件直接mmap后解析，不再拷进std::string；管道等不能映射的退回到按块read
+    //打开或读取失败时抛出ghJsonException
+    Json parseFile(const std::string & path);
+    //file
+
+    //SAX
+    //parseSax不建树，按文档顺序回调Handler；任一回调返回false时停止解析，parseSax返回false
+    //on_string/on_key给出的string_view只在回调期间有效，需要保留请自行拷贝
+    //默认实现什么都不做，只需重写关心的事件
+    class Handler
+    {
+        public:
+            virtual ~Handler() = default;
+            virtual bool on_null()                    { return true; }
+            virtual bool on_bool(bool)                { return true; }
+            virtual bool on_number(double)            { return true; }
+            //整数和保留原文的数字；默认转成double交给on_number，只关心double的Handler不用改
+            virtual bool on_int64(int64_t value)      { return on_number(double(value)); }
+            virtual bool on_uint64(uint64_t value)    { return on_number(double(value)); }
+            virtual bool on_raw_number(std::string_view text);
+            virtual bool on_string(std::string_view)  { return true; }
+            virtual bool on_key(std::string_view)     { return true; }
+            virtual bool start_object()               { return true; }
+            virtual bool end_object()                 { return true; }
+            virtual bool start_array()                { return true; }
+            virtual bool end_array()                  { return true; }
+    };
+
+    bool parseSax(const std::string & in, Handler & handler);
+    //SAX
+
+    //stream
+    //可以分块喂入的解析器: 数据在字符串、数字、转义中间断开都没关系
+    //不传Handler时在finish()之后用result()取出Json；传了Handler则边读边回调
+    //feed/finish在回调返回false之后都返回false；出错时抛出ghJsonException，位置是从第一块算起的偏移
+    class StreamParser
+    {
+        public:
+            StreamParser();
+            explicit StreamParser(Handler & handler);
+            StreamParser(const StreamParser &) = delete;
+            StreamParser& operator=(const StreamParser &) = delete;
+            ~StreamParser();
+
+            bool feed(const char * data, size_t size);
+            bool feed(std::string_view data) { return feed(data.data(), data.size()); }
+            bool finish();
+            Json result();
+            void reset();   // 丢弃当前状态，可以开始下一个文档
+            void setMaxDepth(size_t depth) { m_maxDepth = depth; }
+        private:
+            enum class Expect : uint8_t { VALUE, ARRAY_FIRST, OBJECT_FIRST, KEY, COLON, NEXT, END };
+            enum class Token  : uint8_t { NONE, STRING, KEY, NUMBER, LITERAL };
+
+            const char * startValue(const char * p, const char * end);
+            const char * continueToken(const char * p, const char * end);
+            void finishScalar(const char * begin, const char * end, size_t pos);
+            std::string_view decodeString(size_t start);
+            void closeContainer();
+            void valueDone();
+            size_t position(const char * p) const { return m_offset + (p - m_chunk); }
+
+            std::unique_ptr<Handler> m_builder;  // 没有传Handler时用来建树
+            Handler *         m_handler;
+            std::vector<char> m_stack;           // 未闭合的 [ 和 {
+            std::string       m_token;           // 跨块的未完成token
+            std::string       m_buffer;          // 字符串解码缓冲
+            const char *      m_chunk;
+            size_t            m_offset;          // 当前块之前已经喂入的字节数
+            size_t            m_maxDepth;
+            Expect            m_expect;
+            Token             m_tokenType;
+            bool              m_escaped;         // 字符串里上一个字符是反斜杠
+            bool              m_hasEscape;
+            bool              m_stopped;
+    };
+    //stream
+
+    //writer
+    //Writer的输出目标；需要回调时继承Sink实现write即可
+    //写失败时抛出ghJsonException
+    class Sink
+    {
+        public:
+            virtual ~Sink() = default;
+            virtual void write(const char * data, size_t size) = 0;
+    };
+
+    class FdSink : public Sink
+    {
+        public:
+            explicit FdSink(int fd) : m_fd(fd) {}
+            void write(const char * data, size_t size) override;
+        private:
+            int m_fd;
+    };
+
+    class FileSink : public Sink
+    {
+        public:
+            explicit FileSink(std::FILE * file) : m_file(file) {}
+            void write(const char * data, size_t size) override;
+        private:
+            std::FILE * m_file;
+    };
+
+    class StreamSink : public Sink
+    {
+        public:
+            explicit StreamSink(std::ostream & os) : m_os(os) {}
+            void write(const char * data, size_t size) override;
+        private:
+            std::ostream & m_os;
+    };
+
+    //按事件直接写JSON，不需要先建Json树；同时也是Handler，可以交给parseSax/StreamParser重新输出
+    //写到Sink时只用一块bufferSize大小的缓冲，写满就交给Sink；写到std::string时追加在末尾
+    //缓冲里的内容在flush()或析构之后才完整地出现在Sink/string里
+    //只写一个顶层值；对象里的值前面必须先on_key，顺序不对时抛出ghJsonException
+    class Writer : public Handler
+    {
+        public:
+            explicit Writer(Sink & sink, const DumpOptions & options = DumpOptions(), size_t bufferSize = 64 * 1024);
+            explicit Writer(std::string & out, const DumpOptions & options = DumpOptions());
+            Writer(const Writer &) = delete;
+            Writer& operator=(const Writer &) = delete;
+            ~Writer();
+
+            bool on_null() override;
+            bool on_bool(bool value) override;
+            bool on_number(double value) override;
+            bool on_int64(int64_t value) override;
+            bool on_uint64(uint64_t value) override;
+            bool on_raw_number(std::string_view text) override;
+            bool on_string(std::string_view value) override;
+            bool on_key(std::string_view key) override;
+            bool start_object() override;
+            bool end_object() override;
+            bool start_array() override;
+            bool end_array() override;
+
+            void write(const Json & json);
+            void flush();
+        private:
+            void grow(size_t n);
+            void ensure(size_t n) { if(size_t(m_end - m_cur) < n) grow(n); }
+            void put(char c) { *m_cur++ = c; }
+            void put(const char * data, size_t size);
+            void beforeValue();
+            void writeString(std::string_view str);
+            void writeNumber(double value);
+            void writeValue(const Json & json);
+            void newline(size_t level);
+
+            Sink *               m_sink;
+            std::string *        m_out;
+            std::vector<char>    m_buffer;
+            char *               m_cur;
+            char *               m_end;
+            std::vector<uint8_t> m_stack;   // 每层未闭合的容器: 是否对象、是否已经有元素、是否有等待值的键
+            bool                 m_done;    // 顶层值已经写完
+            DumpOptions          m_options;
+    };
+    //writer
+
+    //ndjson
+    //每行一个JSON值(JSON Lines)，字符串里的换行不算分隔，只有空白的行跳过
+    //按行切开后多线程解析，threads为0时使用std::thread::hardware_concurrency()
+    //出错时抛出序号最小的那条记录的异常，位置是在整个输入里的偏移
+    std::vector<Json> parseNdjson(const std::string & in, size_t threads = 0);
+    //逐条交给RecordHandler，不保留整个结果；on_record在工作线程里并发调用，index是记录序号
+    class RecordHandler
+    {
+        public:
+            virtual ~RecordHandler() = default;
+            virtual void on_record(size_t index, Json && value) = 0;
+    };
+    void parseNdjson(const std::string & in, RecordHandler & handler, size_t threads = 0);
+    std::vector<Json> parseNdjsonFile(const std::string & path, size_t threads = 0);
+    //ndjson
+
+    //第一阶段: 找出字符串之外的 {}[]:, 、字符串开头的引号以及其他值的第一个字符的位置
+    void scanStructurals(const std::string & in, std::vector<uint32_t> & out);
+
+    //Arena
+    //简单的bump分配器: 按块向系统申请内存，对象只能整体释放
+    class Arena
+    {
+        public:
+            explicit Arena(size_t chunkSize = 4096) noexcept;
+            Arena(const Arena &) = delete;
+            Arena(Arena && other) noexcept;
+            Arena& operator=(const Arena &) = delete;
+            Arena& operator=(Arena && other) noexcept;
+            ~Arena() noexcept { clear(); }
+
+            void * allocate(size_t size, size_t align = alignof(std::max_align_t));
+            template<typename T>
+            T * allocate(size_t n) { return static_cast<T *>(allocate(sizeof(T) * n, alignof(T))); }
+            void clear() noexcept;
+            size_t capacity() const { return m_capacity; }
+        private:
+            struct Chunk { Chunk * next; size_t size; };
+            Chunk * m_head;
+            char *  m_cur;
+            char *  m_end;
+            size_t  m_chunkSize;
+            size_t  m_capacity;
+    };
+    //Arena
+
+    //KeyPool
+    //键的驻留表: 相同的键只存一份，驻留后的键地址唯一，可以在多个Document之间共享
+    //未冻结时不是线程安全的；freeze()之后只读，可以被多个线程同时使用
+    class KeyPool
+    {
+        public:
+            KeyPool() noexcept;
+            KeyPool(const KeyPool &) = delete;
+            KeyPool& operator=(const KeyPool &) = delete;
+
+            std::string_view seed(std::string_view key);            // 预置已知的键，不计入统计
+            void freeze() { m_frozen = true; }                       // 之后只查不加，表的大小不再增长
+            bool frozen() const { return m_frozen; }
+            //返回驻留的键；冻结后遇到不在表里的键返回data()为nullptr的string_view
+            std::string_view intern(std::string_view key);
+            std::string_view find(std::string_view key) const;     // 只查找，不插入也不计数
+
+            size_t size()   const { return m_size; }
+            size_t hits()   const { return m_hits.load(std::memory_order_relaxed); }
+            size_t misses() const { return m_misses.load(std::memory_order_relaxed); }
+            double hitRate() const;
+            void   resetStats();
+        private:
+            struct Slot { const char * s; uint32_t size; uint32_t hash; };
+            Arena               m_arena;    // 键的内容，地址不会变
+            std::vector<Slot>   m_slots;    // 线性探测，s为nullptr表示空槽
+            size_t              m_size;
+            bool                m_frozen;
+            std::atomic<size_t> m_hits;
+            std::atomic<size_t> m_misses;
+
+            const Slot * lookup(std::string_view key, uint32_t hash) const;
+            std::string_view insert(std::string_view key, uint32_t hash);
+            std::string_view intern(std::string_view key, size_t & hits, size_t & misses);
+            void addStats(size_t hits, size_t misses);
+
+            friend class DocumentParser;
+    };
+    //KeyPool
+
+    //Document
+    //所有节点、字符串都放在Document的Arena里，只读，随Document一起释放
+    //parseView得到的Document里不含转义的字符串和键直接指向输入，调用方需保证输入比Document活得久
+    struct DocMember;
+    struct DocNode
+    {
+        JsonType tag;
+        uint32_t size;          // STRING: 字节数, ARRAY/OBJECT: 元素个数, NUMBER: NumberType
+        union
+        {
+            bool             b;
+            double           n;
+            int64_t          i;
+            uint64_t         u;
+            const char *     s;
+            const DocNode *  items;
+            const DocMember * members;
+        };
+    };
+    static_assert(sizeof(DocNode) == 16, "DocNode should stay 16 bytes");
+
+    class DocValue;
+    class DocArrayIter;
+    class DocObjectIter;
+
+    class DocValue
+    {
+        private:
+            const DocNode * m_node;
+        public:
+            DocValue() noexcept : m_node(nullptr) {}
+            explicit DocValue(const DocNode * node) noexcept : m_node(node) {}
+            //type
+            JsonType type() const;
+            bool is_null()   const { return type() == JsonType::NUL;    }
+            bool is_number() const { return type() == JsonType::NUMBER; }
+            bool is_bool()   const { return type() == JsonType::BOOL;   }
+            bool is_string() const { return type() == JsonType::STRING; }
+            bool is_array()  const { return type() == JsonType::ARRAY;  }
+            bool is_object() const { return type() == JsonType::OBJECT; }
+            //type
+            //getValue
+            double           getNumber() const;
+            int64_t          getInt64()  const;     // 和Json一样，不能精确表示时抛异常
+            uint64_t         getUint64() const;
+            bool             getBool()   const;
+            std::string_view getString() const;
+            size_t           size()      const;
+            //getValue
+            //operator[]
+            DocValue operator[](size_t index) const;
+            DocValue operator[](std::string_view key) const;
+            //operator[]
+            //find: 类型不对或不存在时返回空的DocValue(转成bool为false)，不抛异常
+            DocValue find(size_t index) const noexcept;
+            DocValue find(std::string_view key) const noexcept;
+            explicit operator bool() const { return m_node != nullptr; }
+            //find
+            //iterator
+            DocArrayIter  arrayBegin()  const;
+            DocArrayIter  arrayEnd()    const;
+            DocObjectIter objectBegin() const;
+            DocObjectIter objectEnd()   const;
+            //iterator
+            Json toJson() const;
+    };
+
+    struct DocMember
+    {
+        DocNode key;
+        DocNode value;
+    };
+
+    class DocArrayIter
+    {
+        private:
+            const DocNode * m_node;
+        public:
+            explicit DocArrayIter(const DocNode * node) noexcept : m_node(node) {}
+            DocValue operator*() const { return DocValue(m_node); }
+            DocArrayIter& operator++() { m_node++; return *this; }
+            bool operator==(const DocArrayIter & rhs) const { return m_node == rhs.m_node; }
+            bool operator!=(const DocArrayIter & rhs) const { return m_node != rhs.m_node; }
+    };
+
+    class DocObjectIter
+    {
+        private:
+            const DocMember * m_member;
+        public:
+            struct Entry
+            {
+                std::string_view first;
+                DocValue         second;
+                const Entry * operator->() const { return this; }
+            };
+            explicit DocObjectIter(const DocMember * member) noexcept : m_member(member) {}
+            Entry operator*() const { return Entry{std::string_view(m_member->key.s, m_member->key.size), DocValue(&m_member->value)}; }
+            Entry operator->() const { return **this; }
+            DocObjectIter& operator++() { m_member++; return *this; }
+            bool operator==(const DocObjectIter & rhs) const { return m_member == rhs.m_member; }
+            bool operator!=(const DocObjectIter & rhs) const { return m_member != rhs.m_member; }
+    };
+
+    class Document
+    {
+        private:
+            Arena                m_arena;
+            DocNode              m_root;
+            std::vector<DocNode> m_stack;   // 解析时暂存尚未定长的数组/对象元素
+            KeyPool *            m_keys;
+            void parse(const std::string & in, bool view);
+        public:
+            Document() noexcept;
+            Document(const Document &) = delete;
+            Document(Document &&) noexcept = default;
+            Document& operator=(const Document &) = delete;
+            Document& operator=(Document &&) noexcept = default;
+
+            void parse(const std::string & in);
+            void parseView(const std::string & in);
+            void parseView(std::string && in) = delete;   // 临时字符串会先于Document释放
+            //之后解析出的键放进keys(nullptr表示不用)，keys要比Document活得久
+            //用同一个KeyPool驻留过的键查找时先比较地址
+            void setKeyPool(KeyPool * keys) { m_keys = keys; }
+            DocValue root() const { return DocValue(&m_root); }
+            size_t memoryUsage() const { return m_arena.capacity(); }
+
+            //和Json相同的只读接口
+            JsonType type() const { return root().type(); }
+            DocValue operator[](size_t index) const { return root()[index]; }
+            DocValue operator[](std::string_view key) const { return root()[key]; }
+            Json toJson() const { return root().toJson(); }
+
+            friend class DocumentParser;
+    };
+
+    Document parseDocument(const std::string & in);
+    Document parseView(const std::string & in);
+    Document parseView(std::string && in) = delete;
+    //Document
+
+    //lazy
+    //按需解析: parseLazy只记下根的位置，访问到哪一层才解析哪一层
+    //find/operator[]在对象、数组里逐个跳过不需要的成员，跳过时只匹配引号和括号，不检查其中的语法；
+    //取值(getNumber/getString/toJson等)时才完整校验那个值，值后面必须是 , ] } 或输入结束。输入要比LazyValue活得久
+    class LazyValue
+    {
+        private:
+            std::string_view m_str;     // 整个输入
+            size_t           m_pos;     // 值的第一个字符，npos表示空
+            size_t           m_depth;
+            size_t           m_maxDepth;
+        public:
+            LazyValue() noexcept : m_pos(std::string_view::npos), m_depth(0), m_maxDepth(0) {}
+            LazyValue(std::string_view str, size_t pos, size_t depth, size_t maxDepth) noexcept 
+                : m_str(str), m_pos(pos), m_depth(depth), m_maxDepth(maxDepth) {}
+            explicit operator bool() const { return m_pos != std::string_view::npos; }
+            //type
+            JsonType type() const;
+            bool is_null()   const { return type() == JsonType::NUL;    }
+            bool is_number() const { return type() == JsonType::NUMBER; }
+            bool is_bool()   const { return type() == JsonType::BOOL;   }
+            bool is_string() const { return type() == JsonType::STRING; }
+            bool is_array()  const { return type() == JsonType::ARRAY;  }
+            bool is_object() const { return type() == JsonType::OBJECT; }
+            //type
+            //getValue
+            double           getNumber() const;
+            int64_t          getInt64()  const;
+            uint64_t         getUint64() const;
+            bool             getBool()   const;
+            std::string      getString() const;
+            size_t           size()      const;     // 数组/对象的元素个数，需要跳过全部元素
+            std::string_view raw()       const;     // 这个值在输入里的原文
+            //getValue
+            //operator[]: 不存在时抛异常
+            LazyValue operator[](size_t index) const;
+            LazyValue operator[](std::string_view key) const;
+            //find: 类型不对或不存在时返回空的LazyValue；输入格式错误仍然抛异常
+            LazyValue find(size_t index) const;
+            LazyValue find(std::string_view key) const;
+            //完整解析这个值
+            Json toJson() const;
+    };
+
+    LazyValue parseLazy(const std::string & in, const ParseOptions & options = ParseOptions());
+    LazyValue parseLazy(std::string && in, const ParseOptions & options = ParseOptions()) = delete;   // 临时字符串会先于LazyValue释放
+    //lazy
+
+    //JsonPath
+    //RFC 6901 JSON Pointer，例如 "/request/headers/host"、"/items/0"，~0表示~，~1表示/
+    //构造时解析一次(格式错误抛ghJsonException)，之后查找不再分配内存，也不抛异常
+    class JsonPath
+    {
+        public:
+            explicit JsonPath(std::string_view pointer);
+
+            const Json * find(const Json & root) const noexcept;           // 不存在返回nullptr
+            DocValue     find(const DocValue & root) const noexcept;       // 不存在返回空的DocValue
+            DocValue     find(const Document & doc) const noexcept { return find(doc.root()); }
+            LazyValue    find(const LazyValue & root) const;               // 不存在返回空的LazyValue
+
+            size_t size() const { return m_tokens.size(); }
+            const std::string & str() const { return m_pointer; }
+        private:
+            struct Token
+            {
+                std::string key;    // 解码后的引用记号
+                size_t      index;  // 可以作为数组下标时的值，否则为SIZE_MAX
+            };
+            std::string        m_pointer;
+            std::vector<Token> m_tokens;
+
+            friend class Projection;
+    };
+    //JsonPath
+
+    //projection
+    //解析时只保留指定的字段，由一组JSON Pointer组成，例如 {"/id", "/user/name"}
+    //路径上的对象只保留匹配的成员，其余成员照常校验语法但不建树；路径终点的值整个保留
+    //数组不消耗路径记号，每个元素都按同一层的规则投影，例如 "/items/sku" 保留items里每个元素的sku
+    //路径还没走完就遇到的标量会被丢弃；""表示保留整个文档
+    class Projection
+    {
+        public:
+            Projection() = default;
+            Projection(std::initializer_list<std::string_view> pointers);
+            Projection & add(std::string_view pointer);     // 格式错误抛ghJsonException
+
+            struct Node
+            {
+                std::string       key;
+                bool              all = false;  // 整个值都保留
+                std::vector<Node> children;     // 按key排序
+                const Node * find(std::string_view name) const;
+            };
+            const Node & root() const { return m_root; }
+        private:
+            Node m_root;
+    };
+    //projection
 
     inline const char * ToString(ghjson::JsonType type)
     {
@@ -202,6 +1119,29 @@ namespace ghjson
         }
     }
 
+    inline const char * ToString(ghjson::ParseErrc code)
+    {
+        switch (code) 
+        {
+            case ghjson::ParseErrc::NONE:                  return "no error";
+            case ghjson::ParseErrc::UNEXPECTED_END:        return "unexpected end";
+            case ghjson::ParseErrc::INVALID_LITERAL:       return "invalid literal";
+            case ghjson::ParseErrc::INVALID_NUMBER:        return "invalid number";
+            case ghjson::ParseErrc::NUMBER_OUT_OF_RANGE:   return "number out of range";
+            case ghjson::ParseErrc::INVALID_ESCAPE:        return "invalid escape";
+            case ghjson::ParseErrc::INVALID_UNICODE:       return "invalid unicode escape";
+            case ghjson::ParseErrc::INVALID_SURROGATE:     return "invalid unicode surrogate";
+            case ghjson::ParseErrc::EXPECTED_KEY:          return "expected key";
+            case ghjson::ParseErrc::EXPECTED_COLON:        return "expected ':'";
+            case ghjson::ParseErrc::EXPECTED_ARRAY_COMMA:  return "expected ',' or ']'";
+            case ghjson::ParseErrc::EXPECTED_OBJECT_COMMA: return "expected ',' or '}'";
+            case ghjson::ParseErrc::UNEXPECTED_CHARACTER:  return "unexpected character";
+            case ghjson::ParseErrc::DEPTH_EXCEEDED:        return "exceeded maximum nesting depth";
+            case ghjson::ParseErrc::OUT_OF_MEMORY:         return "out of memory";
+            default:                                       return "unknown";
+        }
+    }
+
     inline std::ostream & operator<<(std::ostream & os, ghjson::JsonType tag)
     {
         return os << std::string(ToString(tag));
@@ -1,10 +1,39 @@
 #include <iostream>
 #include <cmath>
+#include <thread>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <clocale>
+#include <random>
+#include <sstream>
+#include <memory_resource>
+#if defined(__unix__)
+#include <unistd.h>
+#endif
 #include "ghjson.hpp"
 
 using namespace std;
 int succ = 0;
 int count  = 0;
+
+//统计全局堆分配次数: 普通、数组和带大小的版本一起替换；nothrow默认转到这里，对齐的版本另成一对，不统计
+atomic<size_t> heapAllocations(0);
+
+void * countedNew(size_t size)
+{
+    heapAllocations.fetch_add(1, memory_order_relaxed);
+    if(void * p = malloc(size ? size : 1))
+        return p;
+    throw bad_alloc();
+}
+void * operator new(size_t size) { return countedNew(size); }
+void * operator new[](size_t size) { return countedNew(size); }
+void operator delete(void * p) noexcept { free(p); }
+void operator delete[](void * p) noexcept { free(p); }
+void operator delete(void * p, size_t) noexcept { free(p); }
+void operator delete[](void * p, size_t) noexcept { free(p); }
 double epsilon = 1e-5;
 
 void TestparseObject(ghjson::object expect, const string jsonStr)
@@ -129,6 +158,20 @@ void TestparseLiteral(string jsonStr)
     count++;
 }
 
+void TestparseInvalid(string jsonStr)
+{
+    try 
+    {
+        ghjson::Json json = ghjson::parse(jsonStr);
+        cerr << "parsing " << jsonStr << ", expected error, got: " << json.dump() << endl;
+    } 
+    catch (const ghjson::ghJsonException& ex) 
+    {
+        succ++;
+    }
+    count++;
+}
+
 void TestparseWrong() 
 {
     TestparseLiteral("");
@@ -145,7 +188,7 @@ void TestObject()
     arr.push_back(false);
     arr.push_back(12321);
 
-    map<string, ghjson::Json> obj;
+    ghjson::object obj;
     obj.insert(pair<string, ghjson::Json>("key1", "value1" ));
     obj.insert(pair<string, ghjson::Json>("key2", true ));
     obj.insert(pair<string, ghjson::Json>("key3", arr ));
@@ -176,12 +219,26 @@ void TestString()
     TestparseString("Hello\nWorld", "\"Hello\\nWorld\"");
     
     TestparseString("\" \\ / \b \f \n \r \t", "\"\\\" \\\\ \\/ \\b \\f \\n \\r \\t\"");
-    //TestparseString("Hello\0World", "\"Hello\\u0000World\"");
-    //TestparseString("\x24", "\"\\u0024\"");         /* Dollar sign U+0024 */
-    //TestparseString("\xC2\xA2", "\"\\u00A2\"");     /* Cents sign U+00A2 */
-    //TestparseString("\xE2\x82\xAC", "\"\\u20AC\""); /* Euro sign U+20AC */
-    //TestparseString("\xF0\x9D\x84\x9E", "\"\\uD834\\uDD1E\"");  /* G clef sign U+1D11E */
-    //TestparseString("\xF0\x9D\x84\x9E", "\"\\ud834\\udd1e\"");  /* G clef sign U+1D11E */
+    TestparseString(string("Hello\0World", 11), "\"Hello\\u0000World\"");
+    TestparseString("\x24", "\"\\u0024\"");         /* Dollar sign U+0024 */
+    TestparseString("\xC2\xA2", "\"\\u00A2\"");     /* Cents sign U+00A2 */
+    TestparseString("\xE2\x82\xAC", "\"\\u20AC\""); /* Euro sign U+20AC */
+    TestparseString("\xF0\x9D\x84\x9E", "\"\\uD834\\uDD1E\"");  /* G clef sign U+1D11E */
+    TestparseString("\xF0\x9D\x84\x9E", "\"\\ud834\\udd1e\"");  /* G clef sign U+1D11E */
+
+    //超过16字节、转义落在不同位置的长字符串
+    string longText(100, 'x');
+    TestparseString(longText, "\"" + longText + "\"");
+    TestparseString(longText + "\n" + longText, "\"" + longText + "\\n" + longText + "\"");
+    TestparseString(string(17, 'a') + "\"" + string(31, 'b'), "\"" + string(17, 'a') + "\\\"" + string(31, 'b') + "\"");
+
+    TestparseInvalid("\"\\uD834\"");           /* lone high surrogate */
+    TestparseInvalid("\"\\uDD1E\"");           /* lone low surrogate */
+    TestparseInvalid("\"\\uD834\\u0041\"");    /* high surrogate + non-low */
+    TestparseInvalid("\"\\u12G4\"");
+    TestparseInvalid("\"\\u12\"");
+    TestparseInvalid("\"\\x\"");
+    TestparseInvalid("\"" + longText);
 }
 
 void TestNumber()
@@ -215,76 +272,1833 @@ void TestNumber()
     TestparseNumber(-2.2250738585072014e-308, "-2.2250738585072014e-308");
     TestparseNumber( 1.7976931348623157e+308, "1.7976931348623157e+308");  /* Max double */
     TestparseNumber(-1.7976931348623157e+308, "-1.7976931348623157e+308");
+
+    TestparseNumber(12345678901234567890.0, "12345678901234567890"); /* more than 19 digits */
+    TestparseNumber(0.1, "0.1000000000000000000000000001");
+    TestparseNumber(1e22, "1e22");
+    TestparseNumber(123.456e-7, "123.456e-7");
+
+    TestparseInvalid("-");
+    TestparseInvalid("+1");
+    TestparseInvalid(".5");
+    TestparseInvalid("1.");
+    TestparseInvalid("1.e5");
+    TestparseInvalid("1e");
+    TestparseInvalid("1e+");
+    TestparseInvalid("1e400");
+    TestparseInvalid("-1e400");
 }
 
-void TestLiteral()
+void TestNumberExact()
 {
-    TestparseLiteral("true");
-    TestparseLiteral("false");
-    TestparseLiteral("null");
+    const char * cases[] = 
+    {
+        "0.1", "0.2", "0.3", "1.7976931348623157e308", "5e-324", "2.2250738585072011e-308",
+        "9007199254740993", "123456789012345678", "0.000000000000000000000000123",
+        "3.141592653589793238462643383279", "1e23", "8.41e21", "-0.0000123456789e-5"
+    };
+    for(auto str : cases)
+    {
+        double got = ghjson::parse(str).getNumber();
+        if(got == strtod(str, nullptr))
+            succ++;
+        else
+            cerr << "parsing " << str << ", expected: " << strtod(str, nullptr) << ", got: " << got << endl;
+        count++;
+    }
+
+    //小数点是逗号的locale下结果不变(没有安装这样的locale时跳过)
+    for(const char * name : {"de_DE.UTF-8", "fr_FR.UTF-8", "ru_RU.UTF-8"})
+    {
+        if(!setlocale(LC_NUMERIC, name))
+            continue;
+        bool ok = ghjson::parse("1.5").getNumber() == 1.5 && ghjson::parse("3.141592653589793238462643383279").getNumber() == 3.141592653589793
+                  && ghjson::Json::rawNumber("0.30000000000000000001").getNumber() == 0.3;
+        setlocale(LC_NUMERIC, "C");
+        if(ok)
+            succ++;
+        else
+            cerr << "parsing numbers under locale " << name << endl;
+        count++;
+        break;
+    }
 }
 
-void Testparse()
+class SumNumbers : public ghjson::Handler
 {
-    TestLiteral();
-    TestNumber();
-    TestString();
-    TestArray();
-    TestObject();
+    public:
+        double sum = 0;
+        bool on_number(double value) override { sum += value; return true; }
+};
 
-    //TestparseWrong();
+void TestNumberInteger()
+{
+    //整数按int64/uint64精确保存，dump原样输出
+    struct { const char * str; ghjson::NumberType type; } cases[] =
+    {
+        {"0", ghjson::NumberType::INT64},
+        {"-1", ghjson::NumberType::INT64},
+        {"9007199254740993", ghjson::NumberType::INT64},
+        {"9223372036854775807", ghjson::NumberType::INT64},
+        {"-9223372036854775808", ghjson::NumberType::INT64},
+        {"9223372036854775808", ghjson::NumberType::UINT64},
+        {"18446744073709551615", ghjson::NumberType::UINT64},
+    };
+    for(auto & item : cases)
+    {
+        ghjson::ParseOptions structural;
+        structural.structural_index = true;
+        ghjson::Json json = ghjson::parse(item.str);
+        ghjson::Json indexed = ghjson::parse(item.str, structural);
+        if(json.numberType() == item.type && json.dump() == item.str
+            && indexed.numberType() == item.type && indexed.dump() == item.str)
+            succ++;
+        else
+            cerr << "integer " << item.str << ", got: " << json.dump() << endl;
+        count++;
+    }
+
+    //超出64位范围、-0和带小数点/指数的仍然是double
+    const char * doubles[] = { "18446744073709551616", "-9223372036854775809", "-0", "1.0", "1e2" };
+    for(auto str : doubles)
+    {
+        ghjson::Json json = ghjson::parse(str);
+        if(json.numberType() == ghjson::NumberType::DOUBLE && json.getNumber() == strtod(str, nullptr))
+            succ++;
+        else
+            cerr << "integer " << str << ", expected double, got: " << json.dump() << endl;
+        count++;
+    }
+
+    //取值：能精确表示才返回，否则抛出异常
+    bool ok = ghjson::parse("9223372036854775807").getInt64() == INT64_MAX
+        && ghjson::parse("-9223372036854775808").getInt64() == INT64_MIN
+        && ghjson::parse("18446744073709551615").getUint64() == UINT64_MAX
+        && ghjson::parse("1.0").getInt64() == 1
+        && ghjson::parse("42").getUint64() == 42
+        && ghjson::Json(3u).numberType() == ghjson::NumberType::INT64
+        && ghjson::Json(UINT64_MAX).numberType() == ghjson::NumberType::UINT64
+        && ghjson::Json(INT64_MIN).dump() == "-9223372036854775808";
+    const char * inexact[] = { "1.5", "-1", "1e300", "18446744073709551615" };
+    for(int i = 0; i < 4; i++)
+    {
+        try
+        {
+            ghjson::Json json = ghjson::parse(inexact[i]);
+            if(i == 1)
+                json.getUint64();
+            else
+                json.getInt64();
+            ok = false;
+            cerr << "integer " << inexact[i] << ", expected range error" << endl;
+        }
+        catch(const ghjson::ghJsonException&)
+        {
+        }
+    }
+    if(ok)
+        succ++;
+    else
+        cerr << "integer accessors mismatch" << endl;
+    count++;
+
+    //比较按数值进行，不同存储方式之间也一样
+    ok = ghjson::Json(1) == ghjson::Json(1.0)
+        && ghjson::Json(-1) < ghjson::Json(0u)
+        && ghjson::Json(INT64_MAX) < ghjson::Json(uint64_t(INT64_MAX) + 1)
+        && ghjson::Json(int64_t(9007199254740993)) != ghjson::Json(9007199254740992.0)
+        && ghjson::Json(9007199254740992.0) < ghjson::Json(int64_t(9007199254740993))
+        && ghjson::parse("[1, 2.0]") == ghjson::parse("[1.0, 2]");
+    ghjson::Json value = 1.5;
+    value.setInt64(INT64_MIN);
+    ok = ok && value.numberType() == ghjson::NumberType::INT64 && value.getInt64() == INT64_MIN;
+    value.setUint64(UINT64_MAX);
+    ok = ok && value.getUint64() == UINT64_MAX;
+    if(ok)
+        succ++;
+    else
+        cerr << "integer comparison mismatch" << endl;
+    count++;
+
+    //Document、LazyValue、StreamParser同样保留精确整数
+    const string ids = "{\"id\": 9007199254740993, \"big\": 18446744073709551615, \"neg\": -9223372036854775808}";
+    ghjson::Document doc = ghjson::parseDocument(ids);
+    ghjson::LazyValue lazy = ghjson::parseLazy(ids);
+    ghjson::StreamParser stream;
+    stream.feed(ids.substr(0, 20));
+    stream.feed(ids.substr(20));
+    stream.finish();
+    ghjson::Json streamed = stream.result();
+    ok = doc["id"].getInt64() == 9007199254740993
+        && doc["big"].getUint64() == UINT64_MAX
+        && doc["neg"].getInt64() == INT64_MIN
+        && doc.toJson().dump() == ghjson::parse(ids).dump()
+        && lazy["id"].getInt64() == 9007199254740993
+        && lazy["big"].getUint64() == UINT64_MAX
+        && streamed["id"].getInt64() == 9007199254740993
+        && streamed["big"].numberType() == ghjson::NumberType::UINT64
+        && streamed.dump() == ghjson::parse(ids).dump();
+    //只处理on_number的handler照样收到整数
+    SumNumbers sum;
+    ok = ok && ghjson::parseSax("[1, -2, 3.5, 9223372036854775808]", sum)
+        && sum.sum == 1 - 2 + 3.5 + 9223372036854775808.0;
+    if(ok)
+        succ++;
+    else
+        cerr << "integer mismatch: " << doc.toJson().dump() << " / " << streamed.dump() << endl;
+    count++;
 }
 
-void TestSetNumer()
+void TestRawNumber()
 {
-    ghjson::Json num ={1234};
-    cout << "Before: "<< num.getNumber() << endl;
-    num.setNumber(99.123);
-    cout << "After: "<< num.getNumber() << endl;
+    //raw_numbers保留非整数的原文，dump原样输出
+    const string jsonStr = "[1.10, 3.141592653589793238462643383279, 1e-400, -0.0, 7, {\"price\": 19.990}]";
+    const string expect  = "[1.10,3.141592653589793238462643383279,1e-400,-0.0,7,{\"price\":19.990}]";
+    ghjson::ParseOptions options;
+    options.raw_numbers = true;
+    for(int structural = 0; structural < 2; structural++)
+    {
+        options.structural_index = structural;
+        try
+        {
+            ghjson::Json json = ghjson::parse(jsonStr, options);
+            bool ok = json.dump() == expect
+                && json[0].numberType() == ghjson::NumberType::RAW
+                && json[0].getRawNumber() == "1.10"
+                && json[0].getNumber() == 1.1
+                && json[0] == ghjson::Json(1.1)
+                && json[2].getNumber() == 0
+                && json[4].numberType() == ghjson::NumberType::INT64
+                && json[5]["price"].getRawNumber() == "19.990";
+            if(ok)
+                succ++;
+            else
+                cerr << "raw number mismatch: " << json.dump() << endl;
+        }
+        catch(const ghjson::ghJsonException& ex)
+        {
+            cerr << "raw number " << jsonStr << ", got exception: " << ex.what() << endl;
+        }
+        count++;
+
+        //超出double范围的数字和不保留原文时一样报错
+        ghjson::Json out;
+        ghjson::ParseError err;
+        bool rejected = !ghjson::parse("[1.7976931348623159e308]", out, err, options) && err.code == ghjson::ParseErrc::NUMBER_OUT_OF_RANGE && err.offset == 1;
+        try
+        {
+            ghjson::parse("1e400", options);
+            rejected = false;
+        }
+        catch(const ghjson::ghJsonException&)
+        {
+        }
+        rejected = rejected && ghjson::parse("1.7976931348623157e308", options).getRawNumber() == "1.7976931348623157e308";
+        if(rejected)
+            succ++;
+        else
+            cerr << "raw number out of range, expected error" << endl;
+        count++;
+    }
+
+    //rawNumber只接受完整合法的数字
+    bool ok = ghjson::Json::rawNumber("2.50").dump() == "2.50";
+    const char * wrong[] = { "", "1.5x", "01", "+1", "1.", ".5", "1e", "nan", "1e400", "-18e307" };
+    for(auto str : wrong)
+    {
+        try
+        {
+            ghjson::Json::rawNumber(str);
+            ok = false;
+            cerr << "raw number " << str << ", expected error" << endl;
+        }
+        catch(const ghjson::ghJsonException&)
+        {
+        }
+    }
+    if(ok)
+        succ++;
+    count++;
 }
 
-void TestSetArray()
+void TestDocument()
 {
-    ghjson::array test = {}; 
-    ghjson::Json jsonarray (test);
+    const string jsonStr = "{ \"key1\":\"value1\" , \"key2\": true , \"key3\":[ null , -1.5 , false , 12321, \"a\\nb\"] , \"key4\" :{ \"key1\":\"\" , \"key2\": {}, \"key3\": [] }}";
+    try 
+    {
+        ghjson::Document doc = ghjson::parseDocument(jsonStr);
+        bool ok = doc.type() == ghjson::JsonType::OBJECT
+            && doc["key1"].getString() == "value1"
+            && doc["key2"].getBool()
+            && doc["key3"].size() == 5
+            && doc["key3"][0].is_null()
+            && doc["key3"][1].getNumber() == -1.5
+            && doc["key3"][4].getString() == "a\nb"
+            && doc["key4"]["key1"].getString().empty()
+            && doc["key4"]["key2"].size() == 0
+            && doc["key4"]["key3"].size() == 0
+            && doc.toJson() == ghjson::parse(jsonStr);
+        size_t members = 0;
+        for(auto iter = doc.root().objectBegin(); iter != doc.root().objectEnd(); ++iter)
+        {
+            cout << "document : " << iter->first << " : " << iter->second.toJson().dump() << endl;
+            members++;
+        }
+        if(ok && members == 4)
+            succ++;
+        else
+            cerr << "document mismatch: " << doc.toJson().dump() << endl;
+    } 
+    catch (const ghjson::ghJsonException& ex) 
+    {
+        cerr << "parsing document " << jsonStr
+        << ", error at position " << ex.getPosition() << ": " << ex.what() << endl;
+    }
+    count++;
 
-    jsonarray.addToArray({});
-    jsonarray.addToArray(true);
-    jsonarray.addToArray(123123);
-    jsonarray.addToArray("12312312312312312123");
-    cout << "before:\n"<< jsonarray.dump() << endl;
-    for(auto iter = jsonarray.arrayBegin(); iter < jsonarray.arrayEnd(); iter++)
+    for(auto wrong : {"[1, 2", "{\"a\" 1}", "{1: 2}", "[1,]", "tru"})
     {
-        if(iter->is_number() && iter->getNumber() == 123123)
+        try 
         {
-            cout << "find!" << endl;
-            iter->setNumber(98765);
+            ghjson::parseDocument(wrong);
+            cerr << "parsing document " << wrong << ", expected error" << endl;
+        } 
+        catch (const ghjson::ghJsonException& ex) 
+        {
+            succ++;
         }
+        count++;
     }
-    cout << "after:\n"<< jsonarray.dump() << endl;
 }
 
-void TestSetObject()
+void TestDocumentView()
 {
-    ghjson::object test = {}; 
-    ghjson::Json jsonobject(test);
-    cout << jsonobject.type() << endl;
-    jsonobject.addToObject("key1", 123);
-    jsonobject.addToObject("key2", true);
-    jsonobject.addToObject("key213213", "12312312");
-    cout << "before:\n"<< jsonobject.dump() << endl;
-    for(auto iter = jsonobject.objectBegin(); iter != jsonobject.objectEnd(); iter++)
+    const string jsonStr = "{ \"name\":\"value1\" , \"esc\\u0041\": \"a\\nb\" , \"list\":[ \"x\", 1, \"\" ] }";
+    try 
     {
-        if ( iter->second.is_number() && iter->second.getNumber() == 123)
-            iter->second.setNumber(987);
-        else if ( iter->second.is_string() )
-            iter->second.setString("success");
+        ghjson::Document doc = ghjson::parseView(jsonStr);
+        auto inInput = [&](std::string_view str) { return str.data() >= jsonStr.data() && str.data() < jsonStr.data() + jsonStr.size(); };
+        auto first = doc.root().objectBegin();
+        bool ok = doc["name"].getString() == "value1"
+            && inInput(doc["name"].getString())
+            && inInput(first->first)
+            && doc["escA"].getString() == "a\nb"
+            && !inInput(doc["escA"].getString())
+            && doc["list"][0].getString() == "x"
+            && doc["list"][2].getString().empty()
+            && doc.toJson() == ghjson::parse(jsonStr);
+        if(ok)
+            succ++;
+        else
+            cerr << "document view mismatch: " << doc.toJson().dump() << endl;
+    } 
+    catch (const ghjson::ghJsonException& ex) 
+    {
+        cerr << "parsing document view " << jsonStr
+        << ", error at position " << ex.getPosition() << ": " << ex.what() << endl;
     }
-    for(auto iter = jsonobject.objectBegin_const(); iter != jsonobject.objectEnd_const(); iter++)
+    count++;
+
+    //字符串占大头时，视图模式只需要放结构
+    string records = "[";
+    for(int i = 0; i < 200; i++)
+        records += string(i ? "," : "") + "{\"id\": \"" + string(1000, 'a' + i % 26) + "\"}";
+    records += "]";
+    ghjson::Document copied = ghjson::parseDocument(records);
+    ghjson::Document viewed = ghjson::parseView(records);
+    if(viewed.memoryUsage() * 4 < copied.memoryUsage() && viewed.toJson() == copied.toJson())
+        succ++;
+    else
+        cerr << "document view memory: " << viewed.memoryUsage() << " vs " << copied.memoryUsage() << endl;
+    count++;
+
+    const string truncated = "[\"abc";
+    try 
     {
-        cout << "const dump : " << iter->first << " : "<<  iter->second.dump()<< endl;
+        ghjson::parseView(truncated);
+        cerr << "parsing document view, expected error" << endl;
+    } 
+    catch (const ghjson::ghJsonException& ex) 
+    {
+        succ++;
     }
-    cout << "after:\n"<< jsonobject.dump() << endl;
+    count++;
+}
+
+//把事件记成一行文本
+class EventRecorder : public ghjson::Handler
+{
+    public:
+        string events;
+        bool on_null() override                    { events += "null "; return true; }
+        bool on_bool(bool value) override          { events += value ? "true " : "false "; return true; }
+        bool on_number(double value) override      { events += to_string(int(value)) + " "; return true; }
+        bool on_string(std::string_view value) override { events += "s:" + string(value) + " "; return true; }
+        bool on_key(std::string_view key) override { events += "k:" + string(key) + " "; return true; }
+        bool start_object() override               { events += "{ "; return true; }
+        bool end_object() override                 { events += "} "; return true; }
+        bool start_array() override                { events += "[ "; return true; }
+        bool end_array() override                  { events += "] "; return true; }
+};
+
+//找到第一个"id"就停下
+class FindId : public ghjson::Handler
+{
+    public:
+        bool   next = false;
+        double id = 0;
+        size_t numbers = 0;
+        bool on_key(std::string_view key) override { next = key == "id"; return true; }
+        bool on_number(double value) override
+        {
+            numbers++;
+            if(!next)
+                return true;
+            id = value;
+            return false;
+        }
+};
+
+//两个Document共用一个KeyPool: 相同的键地址相同；冻结后未知的键仍然能正常解析
+void TestKeyPool()
+{
+    ghjson::KeyPool keys;
+    std::string_view seeded = keys.seed("user_id");
+    ghjson::Document a, b;
+    a.setKeyPool(&keys);
+    b.setKeyPool(&keys);
+    string first = "{\"user_id\": 1, \"ts\": 2, \"tags\": [{\"ts\": 3}]}";
+    string second = "{\"ts\": 4, \"user\\u005fid\": 5}";
+    try 
+    {
+        a.parse(first);
+        b.parseView(second);
+        auto keyOf = [](const ghjson::DocValue & value, size_t i)
+        {
+            auto iter = value.objectBegin();
+            while(i--)
+                ++iter;
+            return iter->first;
+        };
+        bool ok = keyOf(a.root(), 0).data() == seeded.data()
+            && keyOf(b.root(), 1).data() == seeded.data()
+            && keyOf(a.root(), 1).data() == keyOf(b.root(), 0).data()
+            && keyOf(a["tags"][0], 0).data() == keyOf(b.root(), 0).data()
+            && a[seeded].getNumber() == 1 && b[keys.find("ts")].getNumber() == 4
+            && keys.size() == 3 && keys.hits() == 4 && keys.misses() == 2
+            && fabs(keys.hitRate() - 4.0 / 6) < epsilon;
+
+        keys.freeze();
+        keys.resetStats();
+        ghjson::Document c;
+        c.setKeyPool(&keys);
+        c.parse("{\"user_id\": 6, \"unknown\": 7}");
+        ok = ok && keyOf(c.root(), 0).data() == seeded.data()
+            && c["unknown"].getNumber() == 7 && keys.find("unknown").data() == nullptr
+            && keys.size() == 3 && keys.hits() == 1 && keys.misses() == 1
+            && c.toJson() == ghjson::parse("{\"unknown\": 7, \"user_id\": 6}");
+        if(ok)
+            succ++;
+        else
+            cerr << "key pool mismatch: " << a.toJson().dump() << " " << b.toJson().dump() << " hits " << keys.hits() << " misses " << keys.misses() << endl;
+    }
+    catch (const ghjson::ghJsonException& ex) 
+    {
+        cerr << "key pool error at position " << ex.getPosition() << ": " << ex.what() << endl;
+    }
+    count++;
+}
+
+//RFC 6901 第5节的例子
+void TestJsonPath()
+{
+    string jsonStr = "{\"foo\": [\"bar\", \"baz\"], \"\": 0, \"a/b\": 1, \"c%d\": 2, \"e^f\": 3, \"g|h\": 4,"
+                     " \"i\\\\j\": 5, \"k\\\"l\": 6, \" \": 7, \"m~n\": 8, \"01\": 9}";
+    ghjson::Json json = ghjson::parse(jsonStr);
+    ghjson::Document doc = ghjson::parseDocument(jsonStr);
+    vector<pair<string, ghjson::Json>> cases =
+    {
+        {"", json}, {"/foo", json["foo"]}, {"/foo/0", "bar"}, {"/foo/1", "baz"}, {"/", 0}, {"/a~1b", 1}, {"/c%d", 2},
+        {"/e^f", 3}, {"/g|h", 4}, {"/i\\j", 5}, {"/k\"l", 6}, {"/ ", 7}, {"/m~0n", 8}, {"/01", 9},
+    };
+    for(const auto & item : cases)
+    {
+        ghjson::JsonPath path(item.first);
+        const ghjson::Json * found = path.find(json);
+        ghjson::DocValue value = path.find(doc);
+        if(found && *found == item.second && value && value.toJson() == item.second)
+            succ++;
+        else
+            cerr << "json path " << item.first << " expected: " << item.second.dump() << ", got: " << (found ? found->dump() : "nullptr") << endl;
+        count++;
+    }
+
+    //不存在的路径返回空，不抛异常
+    for(auto missing : {"/bar", "/foo/2", "/foo/-", "/foo/01", "/foo/bar", "/foo/0/x", "/01/0", "/foo/99999999999999999999"})
+    {
+        ghjson::JsonPath path(missing);
+        if(path.find(json) == nullptr && !path.find(doc))
+            succ++;
+        else
+            cerr << "json path " << missing << ", expected not found" << endl;
+        count++;
+    }
+
+    for(auto wrong : {"foo", "/a~", "/a~2"})
+    {
+        try 
+        {
+            ghjson::JsonPath path(wrong);
+            cerr << "json path " << wrong << ", expected error" << endl;
+        } 
+        catch (const ghjson::ghJsonException& ex) 
+        {
+            succ++;
+        }
+        count++;
+    }
+}
+
+void TestLazy()
+{
+    string jsonStr = "{ \"skip\": [\"]}\\\"[{\", {\"x\": [[], {}]}, -1.5e3], \"esc\\u0041\": \"a\\nb\" ,"
+                     " \"list\": [ true , null, {\"k\": [1, 2]} ], \"n\": 7 }";
+    try 
+    {
+        ghjson::Json json = ghjson::parse(jsonStr);
+        ghjson::LazyValue root = ghjson::parseLazy(jsonStr);
+        bool ok = root.is_object() && root.size() == 4
+            && root["n"].getNumber() == 7
+            && root["escA"].getString() == "a\nb"
+            && root["list"][0].getBool() && root["list"][1].is_null()
+            && root["list"][2]["k"].toJson() == json["list"][2]["k"]
+            && root["list"].size() == 3
+            && root["skip"].toJson() == json["skip"]
+            && root["skip"][2].getNumber() == -1500
+            && root["skip"][1].raw() == "{\"x\": [[], {}]}"
+            && !root.find("missing") && !root["list"].find(3) && !root["n"].find("k") && !root.find(0)
+            && ghjson::JsonPath("/list/2/k/1").find(root).getNumber() == 2
+            && !ghjson::JsonPath("/list/9").find(root)
+            && root.toJson() == json;
+        if(ok)
+            succ++;
+        else
+            cerr << "lazy mismatch: " << root.toJson().dump() << endl;
+    }
+    catch (const ghjson::ghJsonException& ex) 
+    {
+        cerr << "lazy parsing " << jsonStr << ", error at position " << ex.getPosition() << ": " << ex.what() << endl;
+    }
+    count++;
+
+    //没访问到的成员只匹配括号，访问时才完整校验
+    string partial = "{\"bad\": [1, 2 3], \"good\": 1}";
+    try 
+    {
+        ghjson::LazyValue root = ghjson::parseLazy(partial);
+        if(root["good"].getNumber() == 1)
+            succ++;
+        root["bad"].toJson();
+        cerr << "lazy parsing " << partial << ", expected error on access" << endl;
+    }
+    catch (const ghjson::ghJsonException& ex) 
+    {
+        succ++;
+    }
+    count += 2;
+
+    for(auto wrong : {"{\"a\": [1}, \"b\": 2}", "{\"a\": \"unterminated, \"b\": 2", "{\"a\" 1, \"b\": 2}", "[1 2]", "[[[[[[[[[[[[1]]]]]]]]]]], 2]"})
+    {
+        try 
+        {
+            string text = wrong;
+            ghjson::ParseOptions options;
+            options.max_depth = 10;
+            ghjson::LazyValue root = ghjson::parseLazy(text, options);
+            root.is_array() ? root[1] : root["b"];
+            cerr << "lazy parsing " << wrong << ", expected error" << endl;
+        } 
+        catch (const ghjson::ghJsonException& ex) 
+        {
+            succ++;
+        }
+        count++;
+    }
+
+    //取值时值后面只能是分隔符；反斜杠在输入末尾时跳过字符串不能越界
+    pair<string, void (*)(const ghjson::LazyValue &)> broken[] = 
+    {
+        {"[12abc]",          [](const ghjson::LazyValue & root) { root[0].getNumber(); }},
+        {"{\"a\":12x}",       [](const ghjson::LazyValue & root) { root["a"].getInt64(); }},
+        {"[7 8]",            [](const ghjson::LazyValue & root) { root[0].getUint64(); }},
+        {"[truex]",          [](const ghjson::LazyValue & root) { root[0].getBool(); }},
+        {"{\"a\": \"s\"x}",    [](const ghjson::LazyValue & root) { root["a"].getString(); }},
+        {"[12abc]",          [](const ghjson::LazyValue & root) { root[0].toJson(); }},
+        {"[1, \"abc\\",      [](const ghjson::LazyValue & root) { root.size(); }},
+        {"{\"a\": \"x\\",      [](const ghjson::LazyValue & root) { root.find("b"); }},
+        {"{\"a\": \"x\\",      [](const ghjson::LazyValue & root) { root.find("a").getString(); }},
+        {"\"abc\\",           [](const ghjson::LazyValue & root) { root.raw(); }},
+    };
+    for(const auto & item : broken)
+    {
+        try 
+        {
+            item.second(ghjson::parseLazy(item.first));
+            cerr << "lazy parsing " << item.first << ", expected error" << endl;
+        } 
+        catch (const ghjson::ghJsonException& ex) 
+        {
+            succ++;
+        }
+        count++;
+    }
+    string spacedStr = "[12 , true\n, \"s\" ]", rootStr = " 5 ";
+    ghjson::LazyValue spaced = ghjson::parseLazy(spacedStr);
+    if(spaced[0].getInt64() == 12 && spaced[1].getBool() && spaced[2].getString() == "s" && ghjson::parseLazy(rootStr).getNumber() == 5)
+        succ++;
+    else
+        cerr << "lazy scalars followed by whitespace" << endl;
+    count++;
+}
+
+void TestProjection()
+{
+    string jsonStr = "{\"id\": 1, \"name\": \"x\", \"user\": {\"name\": \"u\", \"age\": 3, \"tags\": [\"a\"]}, \"a/b\": true,"
+                     " \"items\": [{\"sku\": \"s1\", \"qty\": 1}, 5, {\"qty\": 2}, [{\"sku\": \"s2\"}]], \"big\": {\"k\": [1, {\"x\": null}]}}";
+    vector<pair<ghjson::Projection, string>> cases =
+    {
+        {{"/id", "/user/name"}, "{\"id\": 1, \"user\": {\"name\": \"u\"}}"},
+        {{"/a~1b", "/big"}, "{\"a/b\": true, \"big\": {\"k\": [1, {\"x\": null}]}}"},
+        {{"/items/sku"}, "{\"items\": [{\"sku\": \"s1\"}, {}, [{\"sku\": \"s2\"}]]}"},
+        {{"/user/tags", "/user"}, "{\"user\": {\"name\": \"u\", \"age\": 3, \"tags\": [\"a\"]}}"},
+        {{"/id/x", "/missing"}, "{}"},
+        {{""}, jsonStr},
+        {{}, "{}"},
+    };
+    for(const auto & item : cases)
+    {
+        ghjson::ParseOptions options;
+        options.projection = &item.first;
+        try 
+        {
+            ghjson::Json json = ghjson::parse(jsonStr, options);
+            ghjson::Json expect = ghjson::parse(item.second);
+            if(json == expect)
+                succ++;
+            else
+                cerr << "projection expected: " << expect.dump() << ", got: " << json.dump() << endl;
+        } 
+        catch (const ghjson::ghJsonException& ex) 
+        {
+            cerr << "projection error at position " << ex.getPosition() << ": " << ex.what() << endl;
+        }
+        count++;
+    }
+
+    //被丢弃的成员也要校验
+    ghjson::Projection keepId{"/id"};
+    ghjson::ParseOptions options;
+    options.projection = &keepId;
+    for(auto wrong : {"{\"id\": 1, \"x\": [1 2]}", "{\"x\": {\"y\": tru}, \"id\": 1}", "{\"id\": 1, \"x\": \"\\q\"}"})
+    {
+        try 
+        {
+            ghjson::parse(wrong, options);
+            cerr << "projection parsing " << wrong << ", expected error" << endl;
+        } 
+        catch (const ghjson::ghJsonException& ex) 
+        {
+            succ++;
+        }
+        count++;
+    }
+}
+
+void TestSax()
+{
+    EventRecorder recorder;
+    string expect = "{ k:a [ 1 true null s:x\ny ] k:b { } k:c [ ] } ";
+    try 
+    {
+        if(ghjson::parseSax("{\"a\": [1, true, null, \"x\\ny\"], \"b\": {}, \"c\": []}", recorder) && recorder.events == expect)
+            succ++;
+        else
+            cerr << "sax expected : " << expect << ", got : " << recorder.events << endl;
+    } 
+    catch (const ghjson::ghJsonException& ex) 
+    {
+        cerr << "sax error at position " << ex.getPosition() << ": " << ex.what() << endl;
+    }
+    count++;
+
+    FindId finder;
+    if(!ghjson::parseSax("[{\"n\": 1, \"id\": 42, \"m\": 3}, 4, 5, oops]", finder) && finder.id == 42 && finder.numbers == 2)
+        succ++;
+    else
+        cerr << "sax early stop: id " << finder.id << ", numbers " << finder.numbers << endl;
+    count++;
+
+    for(auto wrong : {"[1, 2", "{\"a\" 1}", "[1,]", "tru"})
+    {
+        ghjson::Handler ignore;
+        try 
+        {
+            ghjson::parseSax(wrong, ignore);
+            cerr << "sax " << wrong << ", expected error" << endl;
+        } 
+        catch (const ghjson::ghJsonException& ex) 
+        {
+            succ++;
+        }
+        count++;
+    }
+}
+
+void TestStream()
+{
+    vector<string> cases = 
+    {
+        "null", " true ", "false", "0", "-12.5e3", "\"\"", "\"a\\\"b\"", "\"\\u20AC \\uD834\\uDD1E\"", "[]", "{}",
+        " [ 1 , [ 2 , [ ] ] , { } ] ",
+        "{ \"key1\":\"value1\" , \"key2\": true , \"key3\":[ null , -1.5e-3 , false , 12321] , \"k\\n4\" :{ \"k{,}\" : \"[:]\" }}",
+    };
+    //每个文档在每个位置切成两块
+    for(const auto & in : cases)
+    {
+        ghjson::Json expect = ghjson::parse(in);
+        size_t ok = 0;
+        for(size_t cut = 0; cut <= in.size(); cut++)
+        {
+            ghjson::StreamParser parser;
+            try 
+            {
+                parser.feed(in.data(), cut);
+                parser.feed(in.data() + cut, in.size() - cut);
+                parser.finish();
+                if(parser.result() == expect)
+                    ok++;
+                else
+                    cerr << "stream " << in << " cut at " << cut << ", got : " << parser.result().dump() << endl;
+            } 
+            catch (const ghjson::ghJsonException& ex) 
+            {
+                cerr << "stream " << in << " cut at " << cut << ", error at position " << ex.getPosition() << ": " << ex.what() << endl;
+            }
+        }
+        if(ok == in.size() + 1)
+            succ++;
+        count++;
+    }
+
+    //一次一个字节，事件和parseSax一致
+    const string & big = cases.back();
+    EventRecorder expect, got;
+    ghjson::parseSax(big, expect);
+    ghjson::StreamParser events(got);
+    for(char c : big)
+        events.feed(&c, 1);
+    if(events.finish() && got.events == expect.events)
+        succ++;
+    else
+        cerr << "stream events expected : " << expect.events << ", got : " << got.events << endl;
+    count++;
+
+    //回调返回false后不再继续
+    FindId finder;
+    ghjson::StreamParser stopper(finder);
+    if(stopper.feed("[{\"n\": 1, \"id\": 4") && !stopper.feed("2}, 5, oops]") && finder.id == 42 && finder.numbers == 2)
+        succ++;
+    else
+        cerr << "stream early stop: id " << finder.id << ", numbers " << finder.numbers << endl;
+    count++;
+
+    //出错的文档不管从哪里切开都要报错
+    for(string wrong : {"[1, 2", "{\"a\" 1}", "[1,]", "tru", "\"abc", "1 2", "[1.]", "{\"a\":1,}", ""})
+    {
+        size_t errors = 0;
+        for(size_t cut = 0; cut <= wrong.size(); cut++)
+        {
+            ghjson::StreamParser parser;
+            try 
+            {
+                parser.feed(wrong.data(), cut);
+                parser.feed(wrong.data() + cut, wrong.size() - cut);
+                parser.finish();
+            } 
+            catch (const ghjson::ghJsonException& ex) 
+            {
+                errors++;
+            }
+        }
+        if(errors == wrong.size() + 1)
+            succ++;
+        else
+            cerr << "stream " << wrong << ", expected error" << endl;
+        count++;
+    }
+
+    //字符串里的错误报在出错的转义上，和parse()的位置一致
+    for(string wrong : {"\"ab\\x\"", "[\"a\", \"\\uZZ12\"]", "{\"k\\q\": 1}", "[\"\\uD800\\u0041\"]", "\"\\uDC00\"", "\"a\\x", "\"abc\\"})
+    {
+        ghjson::Json out;
+        ghjson::ParseError err;
+        ghjson::parse(wrong, out, err);
+        size_t same = 0;
+        for(size_t cut = 0; cut <= wrong.size(); cut++)
+        {
+            ghjson::StreamParser parser;
+            try 
+            {
+                parser.feed(wrong.data(), cut);
+                parser.feed(wrong.data() + cut, wrong.size() - cut);
+                parser.finish();
+            } 
+            catch (const ghjson::ghJsonException& ex) 
+            {
+                if(err && ex.getPosition() == err.offset)
+                    same++;
+                else
+                    cerr << "stream " << wrong << " cut at " << cut << ", error at " << ex.getPosition() << ", parse() reports " << err.offset << endl;
+            }
+        }
+        if(same == wrong.size() + 1)
+            succ++;
+        count++;
+    }
+
+    //reset之后可以接着解析下一个文档
+    ghjson::StreamParser parser;
+    parser.feed("[1, 2");
+    parser.reset();
+    parser.feed("{\"a\": [3]}");
+    parser.finish();
+    if(parser.result() == ghjson::parse("{\"a\": [3]}"))
+        succ++;
+    count++;
+}
+
+class CountRecords : public ghjson::RecordHandler
+{
+    public:
+        std::atomic<size_t> records{0};
+        std::atomic<size_t> indexSum{0};
+        void on_record(size_t index, ghjson::Json && value) override
+        {
+            if(value.is_object())
+                records++;
+            indexSum += index;
+        }
+};
+
+void TestNdjson()
+{
+    //记录里有原样的换行、转义的换行、空行和\r\n
+    string in;
+    vector<ghjson::Json> expect;
+    for(int i = 0; i < 1000; i++)
+    {
+        string line = "{\"id\": " + to_string(i) + ", \"text\": \"line\\n" + (i % 7 == 0 ? "raw\nbreak\\\"" : "") + "\"}";
+        expect.push_back(ghjson::parse(line));
+        in += line + (i % 3 == 0 ? "\r\n" : "\n");
+        if(i % 10 == 0)
+            in += "  \n";
+    }
+    for(size_t threads : {1, 4})
+    {
+        try 
+        {
+            if(ghjson::parseNdjson(in, threads) == expect)
+                succ++;
+            else
+                cerr << "ndjson mismatch with " << threads << " threads" << endl;
+        } 
+        catch (const ghjson::ghJsonException& ex) 
+        {
+            cerr << "ndjson error at position " << ex.getPosition() << ": " << ex.what() << endl;
+        }
+        count++;
+    }
+
+    CountRecords counter;
+    ghjson::parseNdjson(in, counter, 4);
+    if(counter.records == 1000 && counter.indexSum == 999 * 1000 / 2)
+        succ++;
+    else
+        cerr << "ndjson handler: " << counter.records << " records" << endl;
+    count++;
+
+    //出错时报告第一条坏记录在整个输入里的位置
+    string bad = "[1]\n{\"a\": 1} 2\n[2]\n{\"b\" 3}\n";
+    try 
+    {
+        ghjson::parseNdjson(bad, 2);
+        cerr << "ndjson expected error" << endl;
+    } 
+    catch (const ghjson::ghJsonException& ex) 
+    {
+        if(ex.getPosition() == 13)
+            succ++;
+        else
+            cerr << "ndjson error position " << ex.getPosition() << ": " << ex.what() << endl;
+    }
+    count++;
+}
+
+void WriteFile(const string & path, const string & content)
+{
+    FILE * file = fopen(path.c_str(), "wb");
+    fwrite(content.data(), 1, content.size(), file);
+    fclose(file);
+}
+
+void TestFile()
+{
+    const string path = "ghjson_test_file.json";
+    const string jsonStr = "{ \"key1\":\"value1\" , \"key2\": [ null , -1.5 , \"a\\nb\" ] }\n";
+    WriteFile(path, jsonStr);
+    try 
+    {
+        if(ghjson::parseFile(path) == ghjson::parse(jsonStr))
+            succ++;
+        else
+            cerr << "parseFile mismatch: " << ghjson::parseFile(path).dump() << endl;
+    } 
+    catch (const ghjson::ghJsonException& ex) 
+    {
+        cerr << "parseFile error at position " << ex.getPosition() << ": " << ex.what() << endl;
+    }
+    count++;
+
+    WriteFile(path, "[1]\n\n{\"a\": 2}\n");
+    vector<ghjson::Json> expect = {ghjson::parse("[1]"), ghjson::parse("{\"a\": 2}")};
+    if(ghjson::parseNdjsonFile(path, 2) == expect)
+        succ++;
+    else
+        cerr << "parseNdjsonFile mismatch" << endl;
+    count++;
+
+    WriteFile(path, "");
+    for(const string & bad : {path, string("ghjson_no_such_file.json")})
+    {
+        try 
+        {
+            ghjson::parseFile(bad);
+            cerr << "parseFile " << bad << ", expected error" << endl;
+        } 
+        catch (const ghjson::ghJsonException& ex) 
+        {
+            succ++;
+        }
+        count++;
+    }
+    remove(path.c_str());
+
+#if defined(__unix__)
+    //管道不能mmap，走read
+    int fds[2];
+    if(pipe(fds) == 0)
+    {
+        thread writer([&]
+        {
+            string big = "[" + string(100000, ' ') + "\"pipe\"]";
+            for(size_t done = 0; done < big.size(); )
+            {
+                ssize_t n = write(fds[1], big.data() + done, big.size() - done);
+                if(n <= 0)
+                    break;
+                done += n;
+            }
+            close(fds[1]);
+        });
+        try 
+        {
+            if(ghjson::parseFile("/dev/fd/" + to_string(fds[0]))[0].getString() == "pipe")
+                succ++;
+        } 
+        catch (const ghjson::ghJsonException& ex) 
+        {
+            cerr << "parseFile pipe: " << ex.what() << endl;
+        }
+        count++;
+        writer.join();
+        close(fds[0]);
+    }
+#endif
+}
+
+void TestDumpValue(const string & expect, const ghjson::Json & json)
+{
+    if(json.dump() == expect)
+        succ++;
+    else
+        cerr << "dump expected : " << expect << ", got : " << json.dump() << endl;
+    count++;
+}
+
+void TestDump()
+{
+    TestDumpValue("0", ghjson::Json(0));
+    TestDumpValue("-42", ghjson::Json(-42));
+    TestDumpValue("0.1", ghjson::Json(0.1));
+    TestDumpValue("-0", ghjson::Json(-0.0));
+    TestDumpValue("1e+300", ghjson::Json(1e300));
+    TestDumpValue("5e-324", ghjson::Json(5e-324));
+    TestDumpValue("1000000000000000", ghjson::Json(1e15));
+    TestDumpValue("null", ghjson::Json(NAN));
+    TestDumpValue("\"\\u0001\\n\\\"\\\\/\xE2\x82\xAC\"", ghjson::Json("\x01\n\"\\/\xE2\x82\xAC"));
+    TestDumpValue("{\"a\\\"b\":[1,true,null]}", ghjson::parse("{\"a\\\"b\": [1, true, null]}"));
+    TestDumpValue("{\"a\":[],\"b\":{},\"c\":[{}]}", ghjson::parse(" { \"a\" : [ ] , \"b\" : { } , \"c\" : [ { } ] } "));
+
+    //pretty
+    ghjson::DumpOptions pretty;
+    pretty.pretty = true;
+    pretty.indent = 2;
+    ghjson::Json nested = ghjson::parse("{\"e\": {}, \"id\": 7, \"tags\": [\"a\", [], {\"k\": null}]}");
+    string expect = "{\n  \"e\": {},\n  \"id\": 7,\n  \"tags\": [\n    \"a\",\n    [],\n    {\n      \"k\": null\n    }\n  ]\n}";
+    if(nested.dump(pretty) == expect && ghjson::parse(nested.dump(pretty)) == nested)
+        succ++;
+    else
+        cerr << "pretty dump got :\n" << nested.dump(pretty) << endl;
+    count++;
+
+    //任意double都要能原样读回来
+    mt19937_64 rng(7);
+    size_t exact = 0;
+    for(int i = 0; i < 10000; i++)
+    {
+        uint64_t bits = rng();
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        if(!isfinite(value))
+            value = double(int64_t(bits)) / 3;
+        double back = ghjson::parse(ghjson::Json(value).dump()).getNumber();
+        if(memcmp(&back, &value, sizeof(value)) == 0)
+            exact++;
+        else
+            cerr << "dump round trip " << ghjson::Json(value).dump() << endl;
+    }
+    if(exact == 10000)
+        succ++;
+    count++;
+
+    //长字符串里转义落在16字节块的不同位置
+    string text;
+    for(int i = 0; i < 200; i++)
+        text += char(i % 7 == 0 ? '"' : i % 11 == 0 ? '\n' : i % 13 == 0 ? 1 : 'a' + i % 26);
+    ghjson::Json doc = ghjson::parse("{\"k\": [\"x\", {\"y\": 1.5e-7}]}");
+    doc.addToObject(text, ghjson::Json(text));
+    if(ghjson::parse(doc.dump()) == doc)
+        succ++;
+    else
+        cerr << "dump round trip: " << doc.dump() << endl;
+    count++;
+}
+
+//把每次write收下来，检查缓冲上限
+class ChunkSink : public ghjson::Sink
+{
+    public:
+        string data;
+        size_t largest = 0;
+        void write(const char * bytes, size_t size) override
+        {
+            data.append(bytes, size);
+            largest = max(largest, size);
+        }
+};
+
+void TestWriter()
+{
+    //不建树直接写
+    string out;
+    {
+        ghjson::Writer writer(out);
+        writer.start_object();
+        writer.on_key("id");
+        writer.on_number(7);
+        writer.on_key("tags");
+        writer.start_array();
+        writer.on_string("a\"b");
+        writer.on_bool(false);
+        writer.on_null();
+        writer.end_array();
+        writer.end_object();
+    }
+    ghjson::Json expect = ghjson::parse("{\"id\": 7, \"tags\": [\"a\\\"b\", false, null]}");
+    if(out == expect.dump() && ghjson::parse(out) == expect)
+        succ++;
+    else
+        cerr << "writer got : " << out << endl;
+    count++;
+
+    //固定缓冲分块交给Sink，内容和dump一致
+    string text(1000, 'x');
+    ghjson::Json big = ghjson::parse("{ \"key1\":\"value1\" , \"key2\": true , \"key3\":[ null , -1.5e-3 , false , 12321, [] ] , \"key4\" :{ \"k{,}\" : \"[:]\", \"e\": {} }}");
+    big.addToObject("text", ghjson::Json(text + "\n" + text));
+    ChunkSink chunks;
+    {
+        ghjson::Writer writer(chunks, ghjson::DumpOptions(), 64);
+        writer.write(big);
+    }
+    if(chunks.data == big.dump() && chunks.largest <= 64)
+        succ++;
+    else
+        cerr << "writer sink: largest chunk " << chunks.largest << endl;
+    count++;
+
+    ostringstream os;
+    big.dumpTo(os);
+    FILE * file = tmpfile();
+    big.dumpTo(file);
+    rewind(file);
+    string fromFile(big.dump().size() + 1, '\0');
+    fromFile.resize(fread(&fromFile[0], 1, fromFile.size(), file));
+    fclose(file);
+    if(os.str() == big.dump() && fromFile == big.dump())
+        succ++;
+    else
+        cerr << "dumpTo mismatch" << endl;
+    count++;
+
+    //作为Handler重新输出解析事件
+    string again;
+    {
+        ghjson::Writer writer(again);
+        ghjson::parseSax(big.dump(), writer);
+    }
+    if(again == big.dump())
+        succ++;
+    else
+        cerr << "writer as handler got : " << again << endl;
+    count++;
+
+    try 
+    {
+        string broken;
+        ghjson::Writer writer(broken);
+        writer.start_array();
+        writer.end_object();
+        cerr << "writer expected error" << endl;
+    } 
+    catch (const ghjson::ghJsonException& ex) 
+    {
+        succ++;
+    }
+    count++;
+
+    //对象里没有键的值、第二个顶层值、没有值的键都是错误
+    void (*misuses[])(ghjson::Writer &) = {
+        [](ghjson::Writer & writer) { writer.start_object(); writer.on_number(1); },
+        [](ghjson::Writer & writer) { writer.start_object(); writer.on_key("a"); writer.on_null(); writer.on_bool(true); },
+        [](ghjson::Writer & writer) { writer.on_number(1); writer.on_number(2); },
+        [](ghjson::Writer & writer) { writer.start_array(); writer.end_array(); writer.start_object(); },
+        [](ghjson::Writer & writer) { writer.start_object(); writer.on_key("a"); writer.on_key("b"); },
+        [](ghjson::Writer & writer) { writer.start_object(); writer.on_key("a"); writer.end_object(); },
+    };
+    for(auto misuse : misuses)
+    {
+        try 
+        {
+            string broken;
+            ghjson::Writer writer(broken);
+            misuse(writer);
+            cerr << "writer expected error : " << broken << endl;
+        } 
+        catch (const ghjson::ghJsonException& ex) 
+        {
+            succ++;
+        }
+        count++;
+    }
+}
+
+void TestStructuralIndex()
+{
+    ghjson::ParseOptions options;
+    options.structural_index = true;
+    vector<string> cases = 
+    {
+        "null", " true ", "false", "-12.5e3", "\"\"", "\"a\\\"b\"", "[]", "{}", " [ 1 , [ 2 , [ ] ] , { } ] ",
+        "{ \"key1\":\"value1\" , \"key2\": true , \"key3\":[ null , true , false , 12321] , \"key4\" :{ \"k{,}\" : \"[:]\" }}",
+    };
+    //转义和引号落在64字节块的边界上
+    for(size_t pad = 55; pad < 70; pad++)
+    {
+        cases.push_back("[\"" + string(pad, 'x') + "\\\\\", \"\\\"\\\\\\\"]\", 1]");
+        cases.push_back("{\"" + string(pad, ' ') + "\": [true,false], \"b\\\\\":" + string(pad, ' ') + "-1}");
+    }
+    for(const auto & str : cases)
+    {
+        try 
+        {
+            ghjson::Json expect = ghjson::parse(str);
+            ghjson::Json json = ghjson::parse(str, options);
+            if(json == expect)
+                succ++;
+            else
+                cerr << "structural index parsing " << str << ", expected: " << expect.dump() << ", got: " << json.dump() << endl;
+        } 
+        catch (const ghjson::ghJsonException& ex) 
+        {
+            cerr << "structural index parsing " << str
+            << ", error at position " << ex.getPosition() << ": " << ex.what() << endl;
+        }
+        count++;
+    }
+
+    for(auto wrong : {"[1, 2", "{\"a\" 1}", "[1,]", "tru", "\"abc", "[\"a\"b]", "[1 2]", "{\"a\":1,}"})
+    {
+        try 
+        {
+            ghjson::parse(wrong, options);
+            cerr << "structural index parsing " << wrong << ", expected error" << endl;
+        } 
+        catch (const ghjson::ghJsonException& ex) 
+        {
+            succ++;
+        }
+        count++;
+    }
+
+    //和parse()一样读完第一个完整的值就结束，后面的内容不管(包括配不平的引号)
+    vector<pair<string, string>> trailing =
+    {
+        {"-922u3372003685475809", "-922"}, {"\"\"\n\"", "\"\""}, {"truex", "true"}, {"[1, 2] 3", "[1,2]"},
+        {"{\"a\": 1}{\"", "{\"a\":1}"}, {"\"s\" ]", "\"s\""},
+    };
+    ghjson::Parser parser(options);
+    for(const auto & c : trailing)
+    {
+        ghjson::Json plain, indexed;
+        ghjson::ParseError err1, err2;
+        bool ok = ghjson::parse(c.first).dump() == c.second && ghjson::parse(c.first, options).dump() == c.second
+                  && ghjson::parse(c.first, plain, err1) && ghjson::parse(c.first, indexed, err2, options)
+                  && plain.dump() == c.second && indexed.dump() == c.second && parser.parse(c.first).dump() == c.second;
+        if(ok)
+            succ++;
+        else
+            cerr << "structural index trailing content " << c.first << ", expected: " << c.second << endl;
+        count++;
+    }
+}
+
+void TestParseError()
+{
+    struct Case
+    {
+        string in;
+        ghjson::ParseErrc code;
+        size_t offset, line, column;
+    };
+    vector<Case> cases =
+    {
+        {"",                       ghjson::ParseErrc::UNEXPECTED_END,        0,  1, 1},
+        {"[1, 2",                  ghjson::ParseErrc::UNEXPECTED_END,        5,  1, 6},
+        {"[nul]",                  ghjson::ParseErrc::INVALID_LITERAL,       1,  1, 2},
+        {"[1, -]",                 ghjson::ParseErrc::INVALID_NUMBER,        5,  1, 6},
+        {"1e400",                  ghjson::ParseErrc::NUMBER_OUT_OF_RANGE,   0,  1, 1},
+        {"\"a\\qb\"",              ghjson::ParseErrc::INVALID_ESCAPE,        3,  1, 4},
+        {"\"\\u12G4\"",            ghjson::ParseErrc::INVALID_UNICODE,       2,  1, 3},
+        {"\"\\uDC00\"",            ghjson::ParseErrc::INVALID_SURROGATE,     6,  1, 7},
+        {"{1: 2}",                 ghjson::ParseErrc::EXPECTED_KEY,          1,  1, 2},
+        {"{\"a\" 1}",              ghjson::ParseErrc::EXPECTED_COLON,        5,  1, 6},
+        {"[1 2]",                  ghjson::ParseErrc::EXPECTED_ARRAY_COMMA,  3,  1, 4},
+        {"{\"a\": 1 \"b\": 2}",      ghjson::ParseErrc::EXPECTED_OBJECT_COMMA, 8,  1, 9},
+        {"{\n  \"a\": [1,\n    x]\n}", ghjson::ParseErrc::INVALID_NUMBER,        17, 3, 5},
+    };
+    for(const auto & c : cases)
+    {
+        ghjson::Json out = "unchanged";
+        ghjson::ParseError err;
+        bool ok = ghjson::parse(c.in, out, err);
+        if(!ok && err && err.code == c.code && err.offset == c.offset && err.line == c.line && err.column == c.column && out == ghjson::Json("unchanged"))
+            succ++;
+        else
+            cerr << "parse error " << c.in << ", expected " << ToString(c.code) << " at " << c.offset << " (" << c.line << ":" << c.column 
+                 << "), got " << ToString(err.code) << " at " << err.offset << " (" << err.line << ":" << err.column << ")" << endl;
+        count++;
+    }
+
+    //两阶段解析和深度限制
+    {
+        ghjson::ParseOptions options;
+        options.structural_index = true;
+        options.max_depth = 2;
+        ghjson::Json out;
+        ghjson::ParseError err;
+        if(!ghjson::parse("[1, }", out, err, options) && err.code == ghjson::ParseErrc::UNEXPECTED_CHARACTER && err.offset == 4)
+            succ++;
+        else
+            cerr << "structural parse error, got " << ToString(err.code) << " at " << err.offset << endl;
+        if(!ghjson::parse("[[[1]]]", out, err, options) && err.code == ghjson::ParseErrc::DEPTH_EXCEEDED)
+            succ++;
+        else
+            cerr << "structural depth error, got " << ToString(err.code) << endl;
+        if(ghjson::parse(" [[1], {\"a\": \"\\u00e9\"}] ", out, err, options) && !err && out.dump() == "[[1],{\"a\":\"\u00e9\"}]")
+            succ++;
+        else
+            cerr << "structural parse, got " << out.dump() << endl;
+        count += 3;
+    }
+}
+
+//复用的Parser: 结果和ghjson::parse一致，形状相同的文档稳定后不再分配
+void TestParser()
+{
+    auto request = [](int i)
+    {
+        return "{\"id\": " + to_string(i) + ", \"user\": {\"name\": \"user number " + to_string(i * 7) + " with a long name\", \"roles\": [\"admin\", \"dev\"]},"
+               " \"items\": [" + to_string(i) + ", 2.5, null, true, \"a\\nb\"], \"a_rather_long_key_name\": {\"x\": [], \"y\": {}}, \"price\": 19.90}";
+    };
+    ghjson::Projection keepUser{"/user/name", "/items"};
+    for(int mode = 0; mode < 4; mode++)
+    {
+        ghjson::ParseOptions options;
+        options.structural_index = mode == 1;
+        options.raw_numbers = mode == 2;
+        options.projection = mode == 3 ? &keepUser : nullptr;
+        ghjson::Parser parser(options);
+        ghjson::Json out;
+        ghjson::ParseError err;
+        bool ok = true;
+        size_t warm = 0;
+        size_t first = 0, steady = 0;   // 实际的全局operator new次数: 预热阶段和稳定之后
+        for(int i = 0; i < 20; i++)
+        {
+            string in = request(i % 4);
+            size_t before = heapAllocations;
+            ok = ok && parser.parse(in, out, err);
+            (i < 8 ? first : steady) += heapAllocations - before;
+            ok = ok && !err && out == ghjson::parse(in, options) && out.dump() == ghjson::parse(in, options).dump();
+            if(i == 7)
+                warm = parser.allocations();
+        }
+        ok = ok && first > 0 && warm > 0 && parser.allocations() == warm;
+        //抛异常的版本，结果交回去之后同样复用；池子里多了一份文档的节点，列表要先扩一次
+        parser.recycle(std::move(out));
+        for(int i = 0; i < 8; i++)
+        {
+            string in = request(i % 4);
+            size_t before = heapAllocations;
+            ghjson::Json json = parser.parse(in);
+            if(i >= 4)
+                steady += heapAllocations - before;
+            ok = ok && json == ghjson::parse(in, options);
+            before = heapAllocations;
+            parser.recycle(std::move(json));
+            if(i >= 4)
+                steady += heapAllocations - before;
+            if(i == 3)
+                warm = parser.allocations();
+        }
+        if(ok && steady == 0 && parser.allocations() == warm && parser.cachedNodes() > 0)
+            succ++;
+        else
+            cerr << "parser mode " << mode << ": " << steady << " heap allocations after warm-up, allocations() " << warm << " -> " << parser.allocations() << ", got " << out.dump() << endl;
+        count++;
+    }
+
+    //还被别处引用的部分不会被回收
+    ghjson::Parser parser;
+    ghjson::Json out = parser.parse("{\"keep\": [\"long string that is kept\", {\"a\": 1}], \"drop\": [\"x\"]}");
+    ghjson::Json kept = out["keep"];
+    ghjson::Json copy = out;
+    parser.recycle(std::move(out));
+    bool ok = copy["drop"][0].getString() == "x";
+    copy = ghjson::Json();
+    parser.recycle(std::move(copy));
+    for(int i = 0; i < 3; i++)
+        parser.recycle(parser.parse("[\"overwrite the recycled strings\", {\"a\": 2}, [1, 2, 3]]"));
+    ok = ok && kept.dump() == "[\"long string that is kept\",{\"a\":1}]";
+
+    //出错时out不变，错误码和ghjson::parse一致，之后还能接着用
+    ghjson::Json value = "unchanged";
+    ghjson::ParseError err;
+    ok = ok && !parser.parse("{\"a\": [1, 2}", value, err) && err.code == ghjson::ParseErrc::EXPECTED_ARRAY_COMMA && err.offset == 11
+        && value == ghjson::Json("unchanged");
+    try
+    {
+        parser.parse("[1, tru]");
+        ok = false;
+    }
+    catch(const ghjson::ghJsonException & ex)
+    {
+        try
+        {
+            ghjson::parse("[1, tru]");
+        }
+        catch(const ghjson::ghJsonException & expect)
+        {
+            ok = ok && string(ex.what()) == expect.what() && ex.getPosition() == expect.getPosition();
+        }
+    }
+    ok = ok && parser.parse("{\"a\": [1, 2]}", value, err) && value.dump() == "{\"a\":[1,2]}";
+    parser.shrink();
+    ok = ok && parser.cachedNodes() == 0 && parser.parse("[\"after shrink\"]").dump() == "[\"after shrink\"]";
+    if(ok)
+        succ++;
+    else
+        cerr << "parser reuse mismatch: " << kept.dump() << " / " << value.dump() << endl;
+    count++;
+}
+
+//统计分配次数的memory_resource，实际分配交给upstream
+class CountingResource : public std::pmr::memory_resource
+{
+    public:
+        size_t allocated = 0;
+        size_t deallocated = 0;
+        explicit CountingResource(std::pmr::memory_resource * upstream = std::pmr::new_delete_resource()) : m_upstream(upstream) {}
+    private:
+        std::pmr::memory_resource * m_upstream;
+        void * do_allocate(size_t bytes, size_t align) override
+        {
+            allocated++;
+            return m_upstream->allocate(bytes, align);
+        }
+        void do_deallocate(void * p, size_t bytes, size_t align) override
+        {
+            deallocated++;
+            m_upstream->deallocate(p, bytes, align);
+        }
+        bool do_is_equal(const std::pmr::memory_resource & other) const noexcept override { return this == &other; }
+};
+
+void TestMemoryResource()
+{
+    //短字符串和短键放在std::string的内联缓冲里，所以整个文档都在栈上的缓冲里；长的内容仍然走全局堆，不在这里检查
+    //上游是null_memory_resource，缓冲不够会抛bad_alloc
+    string in = "{\"id\": 42, \"name\": \"short\", \"tags\": [\"a\", \"b\", [true, null]], \"price\": 19.90,"
+                " \"nested\": {\"x\": {}, \"y\": []}, \"big\": 18446744073709551616}";
+    ghjson::Projection keepName{"/name", "/nested"};
+    CountingResource global;
+    std::pmr::memory_resource * previous = std::pmr::set_default_resource(&global);
+    bool ok = true;
+    for(int mode = 0; mode < 4; mode++)
+    {
+        alignas(std::max_align_t) char buffer[16 * 1024];
+        std::pmr::monotonic_buffer_resource pool(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+        ghjson::ParseOptions options;
+        options.structural_index = mode == 1;
+        options.raw_numbers = mode == 2;
+        options.projection = mode == 3 ? &keepName : nullptr;
+        ghjson::ParseOptions plain = options;
+        options.resource = &pool;
+        try
+        {
+            ghjson::Json json = ghjson::parse(in, options);
+            ghjson::Json out;
+            ghjson::ParseError err;
+            ok = ok && ghjson::parse(in, out, err, options) && json == out;
+            std::pmr::set_default_resource(previous);
+            ok = ok && json == ghjson::parse(in, plain) && json.dump() == ghjson::parse(in, plain).dump();
+            std::pmr::set_default_resource(&global);
+        }
+        catch(const std::bad_alloc &)
+        {
+            ok = false;
+        }
+    }
+    std::pmr::set_default_resource(previous);
+    ok = ok && global.allocated == 0;
+    if(ok)
+        succ++;
+    else
+        cerr << "monotonic resource: " << global.allocated << " allocations from the default resource" << endl;
+    count++;
+
+    //构造、修改前的复制都留在同一个资源里，全部析构后分配和释放一一对应
+    CountingResource counter;
+    {
+        ghjson::ParseOptions options;
+        options.resource = &counter;
+        ghjson::Json json = ghjson::parse(in, options);
+        size_t before = counter.allocated;
+        ghjson::Json copy = json;
+        copy["nested"]["x"]["added"] = ghjson::Json("value", &counter);
+        ghjson::array items(&counter);
+        items.push_back(1);
+        items.push_back(ghjson::Json::rawNumber("1.50", &counter));
+        ghjson::object members(&counter);
+        members.emplace("items", std::move(items));
+        copy.addToObject("members", ghjson::Json(std::move(members)));
+        ok = counter.allocated > before && json["nested"]["x"].getObject().empty()
+             && copy["members"].dump() == "{\"items\":[1,1.50]}" && copy["members"]["items"].getArray().get_allocator().resource() == &counter;
+    }
+    if(ok && counter.allocated > 0 && counter.allocated == counter.deallocated)
+        succ++;
+    else
+        cerr << "counting resource: " << counter.allocated << " allocations, " << counter.deallocated << " deallocations" << endl;
+    count++;
+
+    //Parser的池子也从资源里分配，别的资源里的节点不缓存
+    CountingResource reused;
+    {
+        ghjson::ParseOptions options;
+        options.resource = &reused;
+        ghjson::Parser parser(options);
+        for(int i = 0; i < 4; i++)
+            parser.recycle(parser.parse(in));
+        ok = parser.cachedNodes() > 0 && reused.allocated > 0;
+        parser.shrink();
+        parser.recycle(ghjson::parse(in));
+        ok = ok && parser.cachedNodes() == 0 && parser.parse(in) == ghjson::parse(in);
+    }
+    if(ok && reused.allocated == reused.deallocated)
+        succ++;
+    else
+        cerr << "parser resource: " << reused.allocated << " allocations, " << reused.deallocated << " deallocations" << endl;
+    count++;
+}
+
+//嵌套层数由ParseOptions::max_depth限制，解析、输出、拷贝和析构都不递归
+void TestDepth()
+{
+    auto nested = [](size_t depth, bool object)
+    {
+        string out;
+        for(size_t i = 0; i < depth; i++)
+            out += object ? "{\"a\":" : "[";
+        out += "1";
+        for(size_t i = 0; i < depth; i++)
+            out += object ? "}" : "]";
+        return out;
+    };
+    ghjson::ParseOptions limit;
+    for(size_t depth : {size_t(1024), size_t(1025)})
+    {
+        for(bool structural : {false, true})
+        {
+            limit.structural_index = structural;
+            try 
+            {
+                ghjson::parse(nested(depth, false), limit);
+                if(depth <= limit.max_depth)
+                    succ++;
+                else
+                    cerr << "depth " << depth << ", expected error" << endl;
+            } 
+            catch (const ghjson::ghJsonException& ex) 
+            {
+                if(depth > limit.max_depth)
+                    succ++;
+                else
+                    cerr << "depth " << depth << ", error at position " << ex.getPosition() << ": " << ex.what() << endl;
+            }
+            count++;
+        }
+    }
+
+    const size_t deep = 300000;
+    ghjson::ParseOptions options;
+    options.max_depth = deep;
+    for(bool object : {false, true})
+    {
+        string str = nested(deep, object);
+        for(bool structural : {false, true})
+        {
+            options.structural_index = structural;
+            try 
+            {
+                ghjson::Json json = ghjson::parse(str, options);
+                ghjson::Json copy = json;
+                object ? copy.setObject({}) : copy.setArray({});
+                if(json.dump() == str && copy.dump() == (object ? "{}" : "[]"))
+                    succ++;
+                else
+                    cerr << "deep " << (object ? "object" : "array") << " round trip mismatch" << endl;
+            } 
+            catch (const ghjson::ghJsonException& ex) 
+            {
+                cerr << "deep " << (object ? "object" : "array") << ", error at position " << ex.getPosition() << ": " << ex.what() << endl;
+            }
+            count++;
+        }
+    }
+    options.structural_index = false;
+
+    //比较也不递归: 两份独立解析的深层文档逐层比较到最里面
+    {
+        auto wrapped = [&](size_t depth, int last)
+        {
+            string out;
+            for(size_t i = 0; i < depth; i++)
+                out += "[0,";
+            out += to_string(last);
+            for(size_t i = 0; i < depth; i++)
+                out += ",0]";
+            return out;
+        };
+        ghjson::Json a = ghjson::parse(wrapped(deep, 1), options);
+        ghjson::Json b = ghjson::parse(wrapped(deep, 1), options);
+        ghjson::Json c = ghjson::parse(wrapped(deep, 2), options);
+        ghjson::Json d = ghjson::parse(nested(100000, false), options);
+        ghjson::Json e = ghjson::parse(nested(100000, false), options);
+        if(a == b && !(a < b) && !(b < a) && a != c && a < c && !(c < a) && d == e && !(d < e) && ghjson::parse("[[1]]") < d)
+            succ++;
+        else
+            cerr << "deep comparison mismatch" << endl;
+        count++;
+    }
+
+    //惰性解析跳过深层子树
+    try 
+    {
+        string str = "[" + nested(deep - 1, false) + ", 2]";
+        ghjson::LazyValue root = ghjson::parseLazy(str, options);
+        if(root[1].getNumber() == 2 && root.size() == 2)
+            succ++;
+    } 
+    catch (const ghjson::ghJsonException& ex) 
+    {
+        cerr << "deep lazy, error at position " << ex.getPosition() << ": " << ex.what() << endl;
+    }
+    count++;
+
+    //流式解析用setMaxDepth设置上限
+    {
+        string str = nested(11, true);
+        ghjson::StreamParser parser;
+        parser.setMaxDepth(10);
+        try 
+        {
+            parser.feed(str);
+            parser.finish();
+            cerr << "stream depth 11, expected error" << endl;
+        } 
+        catch (const ghjson::ghJsonException& ex) 
+        {
+            succ++;
+        }
+        count++;
+
+        str = nested(deep, false);
+        parser.reset();
+        parser.setMaxDepth(deep);
+        try 
+        {
+            parser.feed(str);
+            parser.finish();
+            if(parser.result().dump() == str)
+                succ++;
+        } 
+        catch (const ghjson::ghJsonException& ex) 
+        {
+            cerr << "stream deep, error at position " << ex.getPosition() << ": " << ex.what() << endl;
+        }
+        count++;
+    }
+}
+
+void TestLiteral()
+{
+    TestparseLiteral("true");
+    TestparseLiteral("false");
+    TestparseLiteral("null");
+}
+
+void Testparse()
+{
+    TestLiteral();
+    TestNumber();
+    TestNumberExact();
+    TestNumberInteger();
+    TestRawNumber();
+    TestString();
+    TestArray();
+    TestObject();
+    TestDocument();
+    TestDocumentView();
+    TestKeyPool();
+    TestJsonPath();
+    TestLazy();
+    TestProjection();
+    TestSax();
+    TestStream();
+    TestNdjson();
+    TestFile();
+    TestDump();
+    TestWriter();
+    TestStructuralIndex();
+    TestDepth();
+    TestParseError();
+    TestParser();
+    TestMemoryResource();
+
+    //TestparseWrong();
+}
+
+void TestSetNumer()
+{
+    ghjson::Json num ={1234};
+    cout << "Before: "<< num.getNumber() << endl;
+    num.setNumber(99.123);
+    cout << "After: "<< num.getNumber() << endl;
+}
+
+void TestSetArray()
+{
+    ghjson::array test = {}; 
+    ghjson::Json jsonarray (test);
+
+    jsonarray.addToArray({});
+    jsonarray.addToArray(true);
+    jsonarray.addToArray(123123);
+    jsonarray.addToArray("12312312312312312123");
+    cout << "before:\n"<< jsonarray.dump() << endl;
+    for(auto iter = jsonarray.arrayBegin(); iter < jsonarray.arrayEnd(); iter++)
+    {
+        if(iter->is_number() && iter->getNumber() == 123123)
+        {
+            cout << "find!" << endl;
+            iter->setNumber(98765);
+        }
+    }
+    cout << "after:\n"<< jsonarray.dump() << endl;
+}
+
+void TestSetObject()
+{
+    ghjson::object test = {}; 
+    ghjson::Json jsonobject(test);
+    cout << jsonobject.type() << endl;
+    jsonobject.addToObject("key1", 123);
+    jsonobject.addToObject("key2", true);
+    jsonobject.addToObject("key213213", "12312312");
+    cout << "before:\n"<< jsonobject.dump() << endl;
+    for(auto iter = jsonobject.objectBegin(); iter != jsonobject.objectEnd(); iter++)
+    {
+        if ( iter->second.is_number() && iter->second.getNumber() == 123)
+            iter->second.setNumber(987);
+        else if ( iter->second.is_string() )
+            iter->second.setString("success");
+    }
+    for(auto iter = jsonobject.objectBegin_const(); iter != jsonobject.objectEnd_const(); iter++)
+    {
+        cout << "const dump : " << iter->first << " : "<<  iter->second.dump()<< endl;
+    }
+    cout << "after:\n"<< jsonobject.dump() << endl;
+}
+
+//和std::map做同样的随机插入/删除，结果应一致；ordered时还要检查迭代顺序就是插入顺序
+template<typename M>
+void TestObjectBackend(const char * name, bool ordered)
+{
+    M values;
+    map<string, ghjson::Json> expect;
+    vector<string> order;
+    mt19937 rng(7);
+    bool ok = true;
+    for(int i = 0; i < 20000 && ok; i++)
+    {
+        string key = "k" + to_string(rng() % 3000);
+        if(rng() % 4 == 0)
+        {
+            size_t erased = values.erase(key);
+            ok = erased == expect.erase(key);
+            for(auto iter = order.begin(); erased && iter != order.end(); ++iter)
+                if(*iter == key)
+                {
+                    order.erase(iter);
+                    break;
+                }
+        }
+        else
+        {
+            bool inserted = values.emplace(key, ghjson::Json(i)).second;
+            ok = inserted == expect.emplace(key, ghjson::Json(i)).second;
+            if(inserted)
+                order.push_back(key);
+        }
+    }
+    ok = ok && values.size() == expect.size();
+    for(const auto & item : expect)
+    {
+        auto iter = values.find(item.first);
+        ok = ok && iter != values.end() && iter->second == item.second;
+    }
+    ok = ok && values.find("missing") == values.end() && values.count("k1") == expect.count("k1");
+    if(ordered)
+    {
+        size_t i = 0;
+        for(const auto & item : values)
+            ok = ok && item.first == order[i++];
+    }
+    values["k1"] = "changed";
+    ok = ok && values.find("k1")->second == ghjson::Json("changed");
+
+    //相同内容不同插入顺序的对象相等
+    M a = {{"x", 1}, {"y", 2}}, b = {{"y", 2}, {"x", 1}};
+    ok = ok && a == b && !(a == M{{"x", 1}});
+
+    if(ok)
+        succ++;
+    else
+        cerr << "object backend " << name << " error" << endl;
+    count++;
+}
+
+void TestObjectBackends()
+{
+    TestObjectBackend<ghjson::FlatMap<ghjson::Json>>("flat", false);
+    TestObjectBackend<ghjson::HashMap<ghjson::Json>>("hash", false);
+    TestObjectBackend<ghjson::OrderedMap<ghjson::Json>>("ordered", true);
+
+    //当前编译选用的后端: 解析、比较和按key访问与std::map的语义一致
+    ghjson::Json a = ghjson::parse("{\"b\": 1, \"a\": [2], \"b\": 3}");
+    ghjson::Json b = ghjson::parse("{\"a\": [2], \"b\": 1}");
+    ghjson::Json c = ghjson::parse("{\"a\": [2], \"b\": 2}");
+    if(a == b && b < c && !(c < b) && a["b"].getNumber() == 1 && a.getObject().size() == 2)
+        succ++;
+    else
+        cerr << "object backend compare error: " << a.dump() << " " << b.dump() << " " << c.dump() << endl;
+    count++;
+}
+
+void TestCopyOnWrite()
+{
+    ghjson::Json a = ghjson::parse("{\"config\": {\"port\": 80, \"hosts\": [\"a\", \"b\"]}, \"other\": [1, 2, 3]}");
+    ghjson::Json b = a;
+    const ghjson::Json & ca = a;
+    const ghjson::Json & cb = b;
+    bool shared = &ca.getObject() == &cb.getObject();
+
+    b["config"]["port"].setNumber(8080);
+    b["config"]["hosts"].addToArray("c");
+    bool ok = shared
+        && ca["config"]["port"].getNumber() == 80
+        && cb["config"]["port"].getNumber() == 8080
+        && ca["config"]["hosts"].getArray().size() == 2
+        && cb["config"]["hosts"].getArray().size() == 3
+        && &ca.getObject() != &cb.getObject()
+        && &ca["other"].getArray() == &cb["other"].getArray(); //没改过的子树仍然共享
+    cout << "copy on write: " << ca.dump() << " | " << cb.dump() << endl;
+
+    //多线程同时拷贝、读取共享节点
+    vector<thread> workers;
+    vector<double> sums(4, 0);
+    for(size_t t = 0; t < sums.size(); t++)
+    {
+        workers.emplace_back([&, t]
+        {
+            for(int i = 0; i < 10000; i++)
+            {
+                ghjson::Json copy = ca;
+                const ghjson::Json & c = copy;
+                sums[t] += c["config"]["port"].getNumber() + c["other"][2].getNumber();
+            }
+        });
+    }
+    for(auto & worker : workers)
+        worker.join();
+    for(double sum : sums)
+        ok = ok && sum == 10000 * 83.0;
+
+    if(ok)
+        succ++;
+    else
+        cerr << "copy on write error: " << ca.dump() << " | " << cb.dump() << endl;
+    count++;
 }
 
 void TestSet()
@@ -292,6 +2106,8 @@ void TestSet()
     TestSetNumer();
     TestSetArray();
     TestSetObject();
+    TestObjectBackends();
+    TestCopyOnWrite();
     
 }
 
@@ -306,8 +2122,9 @@ void TestOther()
 
 int main()
 {
-    //Testparse();
-    //cout << "success :" << succ << " total :" << count << endl;
+    Testparse();
     //TestOther();
     TestSet();
+    cout << "success :" << succ << " total :" << count << endl;
+    return succ == count ? 0 : 1;
 }
\ No newline at end of file